@@ -3,36 +3,64 @@
 
 #include <utility>
 #include <functional>
+#include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <type_traits>
 
 #include "auto_traits.hh"
+#include "flat_hash_map.hh"
+#include "hash.hh"
 #include "simple_map.hh"
+#include "small_map.hh"
+#include "sorted_vector_map.hh"
 
 namespace mc {
+  namespace _details_ {
+#ifdef MC_USE_STD_HASH_CONTAINERS
+    template <typename K, typename V, typename Allocator>
+    using HashMapRepresentation = std::unordered_map<K, V, Hash<K>, std::equal_to<K>, Allocator>;
+#else
+    template <typename K, typename V, typename Allocator>
+    using HashMapRepresentation = flat_hash_map<K, V, Hash<K>, std::equal_to<K>, Allocator>;
+#endif
+
+    template <typename K, typename V, typename Allocator>
+    using LargeMapRepresentation =
+      std::conditional_t<traits::hashable<K>::value, HashMapRepresentation<K,V,Allocator>,
+                         std::conditional_t<traits::comparable<K>::value, sorted_vector_map<K, V, std::less<K>, Allocator>,
+                                            simple_map<K, V, std::equal_to<K>, Allocator>>>;
+  }
+
   /**
    * A class representing a (unordered) map that is compatible with most types.
    * The underlying representation for the map is automatically chosen at compile time.
-   * If K is hashable then it uses std::unordered_map,
-   * else it chooses the simple_map representation which works with any type with ==.
+   * Small maps keep their entries inline (see small_map.hh). Once a map outgrows that, its representation is:
+   * flat_hash_map if K is hashable with mc::Hash (see hash.hh), or std::unordered_map if MC_USE_STD_HASH_CONTAINERS is defined,
+   * else sorted_vector_map if K is comparable with operator<,
+   * else simple_map, which works with any key with ==.
+   * Inserting may invalidate references to the entries.
+   * Any memory the map allocates comes from Allocator, as with auto_set.
    */
-  template <typename K, typename V>
+  template <typename K, typename V, typename Allocator = std::allocator<std::pair<const K, V>>>
   class auto_map {
   public:
     using value_type = std::pair<const K, V>;
     // The conditional check to determine which underlying representation to use
     using map_representation =
-      std::conditional_t<traits::hashable<K>::value, std::unordered_map<K,V>, simple_map<K,V>>;
+      small_map<K, V, _details_::DefaultInlineCapacity<std::pair<K,V>>, _details_::LargeMapRepresentation<K,V,Allocator>>;
+    using allocator_type = Allocator;
     using iterator = typename map_representation::iterator;
     using const_iterator = typename map_representation::const_iterator;
 
     auto_map() = default;
     auto_map(auto_map const&) = default;
     auto_map(auto_map&&) = default;
+    explicit auto_map(Allocator const& allocator) : map(allocator) {}
     auto_map(map_representation const& map) : map(map) {}
     auto_map(map_representation&& map) : map(std::move(map)) {}
     template <typename InputIt>
-    auto_map(InputIt first, InputIt last) : map(first, last) {}
+    auto_map(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : map(first, last, allocator) {}
     auto_map(std::initializer_list<std::pair<K,V>> init) : map(init) {}
 
     ~auto_map() = default;
@@ -50,6 +78,10 @@ namespace mc {
       return map != rhs.map;
     }
 
+    allocator_type get_allocator() const {
+      return map.get_allocator();
+    }
+
     iterator begin() {
       return map.begin();
     }
@@ -128,6 +160,11 @@ namespace mc {
   private:
     map_representation map;
   };
+
+  namespace pmr {
+    template <typename K, typename V>
+    using auto_map = mc::auto_map<K, V, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+  }
 }
 
 #endif
@@ -3,37 +3,68 @@
 
 #include <utility>
 #include <functional>
+#include <memory>
+#include <memory_resource>
 #include <unordered_set>
-#include <set>
 #include <type_traits>
 
 #include "auto_traits.hh"
+#include "flat_hash_set.hh"
+#include "hash.hh"
 #include "simple_set.hh"
+#include "small_set.hh"
+#include "sorted_vector_set.hh"
 
 namespace mc {
+  namespace _details_ {
+    // Defining MC_USE_STD_HASH_CONTAINERS makes auto_set and auto_map use the std hash containers instead of the flat ones.
+#ifdef MC_USE_STD_HASH_CONTAINERS
+    template <typename T, typename Allocator>
+    using HashSetRepresentation = std::unordered_set<T, Hash<T>, std::equal_to<T>, Allocator>;
+#else
+    template <typename T, typename Allocator>
+    using HashSetRepresentation = flat_hash_set<T, Hash<T>, std::equal_to<T>, Allocator>;
+#endif
+
+    template <typename T, typename Allocator>
+    using LargeSetRepresentation =
+      std::conditional_t<traits::hashable<T>::value, HashSetRepresentation<T,Allocator>,
+                         std::conditional_t<traits::comparable<T>::value, sorted_vector_set<T, std::less<T>, Allocator>,
+                                            simple_set<T, std::equal_to<T>, Allocator>>>;
+  }
+
   /**
    * A class representing a (unordered) set that is compatible with most types.
    * The underlying representation for the set is automatically chosen at compile time.
-   * If T is hashable then it uses std::unordered_map,
-   * else if T is comparable with operator< then it uses std::set,
-   * else it chooses the simple_set representation which works with any type with ==.
+   * Small sets keep their elements inline (see small_set.hh). Once a set outgrows that, its representation is:
+   * flat_hash_set if T is hashable with mc::Hash (see hash.hh), or std::unordered_set if MC_USE_STD_HASH_CONTAINERS is defined,
+   * else sorted_vector_set if T is comparable with operator<,
+   * else simple_set, which works with any type with ==.
+   * Types without == skip the inline tier and use simple_set directly, which can still hold them as long as nothing is looked up.
+   * Inserting may invalidate references to the elements.
+   * Any memory the set allocates comes from Allocator (std::allocator<T> by default, see hash.hh),
+   * e.g. from a std::pmr::memory_resource with pmr::auto_set below.
    */
-  template <typename T>
+  template <typename T, typename Allocator>
   class auto_set {
   public:
     // The conditional check to determine which underlying representation to use
     using set_representation =
-      std::conditional_t<traits::hashable<T>::value, std::unordered_set<T>, simple_set<T>>;
+      std::conditional_t<traits::equality_comparable<T>::value,
+                         small_set<T, _details_::DefaultInlineCapacity<T>, _details_::LargeSetRepresentation<T,Allocator>>,
+                         simple_set<T, std::equal_to<T>, Allocator>>;
+    using allocator_type = Allocator;
     using iterator = typename set_representation::iterator;
     using const_iterator = typename set_representation::const_iterator;
 
     auto_set() = default;
     auto_set(auto_set const&) = default;
     auto_set(auto_set&&) = default;
+    explicit auto_set(Allocator const& allocator) : set(allocator) {}
     auto_set(set_representation const& set) : set(set) {}
     auto_set(set_representation&& set) : set(std::move(set)) {}
     template <typename InputIt>
-    auto_set(InputIt first, InputIt last) : set(first, last) {}
+    auto_set(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : set(first, last, allocator) {}
     auto_set(std::initializer_list<T> init) : set(init) {}
 
     ~auto_set() = default;
@@ -51,6 +82,10 @@ namespace mc {
       return set != rhs.set;
     }
 
+    allocator_type get_allocator() const {
+      return set.get_allocator();
+    }
+
     iterator begin() {
       return set.begin();
     }
@@ -115,6 +150,12 @@ namespace mc {
   private:
     set_representation set;
   };
+
+  namespace pmr {
+    // An auto_set whose memory comes from a std::pmr::memory_resource, e.g. an arena that lives as long as one search.
+    template <typename T>
+    using auto_set = mc::auto_set<T, std::pmr::polymorphic_allocator<T>>;
+  }
 }
 
 #endif
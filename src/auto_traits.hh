@@ -1,22 +1,42 @@
 #ifndef AUTO_TRAITS_HH
 #define AUTO_TRAITS_HH
 
+#include <optional>
+#include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "hash.hh"
 
 namespace mc {
   namespace traits {
-    // Compile time check to see if a type supports operator< using SFINAE
     template <typename S, typename = void>
-    struct comparable : std::false_type {};
+    struct has_less : std::false_type {};
+    template <typename S>
+    struct has_less<S, std::void_t<decltype(std::declval<S>() < std::declval<S>())>> : std::true_type {};
+
+    // Compile time check to see if a type supports operator< using SFINAE.
+    // The std operator< of pairs, tuples, optionals and vectors is declared for any element type,
+    // so for those the check is made on their elements instead.
     template <typename S>
-    struct comparable<S, std::void_t<decltype(std::declval<S>() < std::declval<S>())>> : std::true_type {};
+    struct comparable : has_less<S> {};
+    template <typename T1, typename T2>
+    struct comparable<std::pair<T1,T2>> : std::bool_constant<comparable<T1>::value && comparable<T2>::value> {};
+    template <typename... Ts>
+    struct comparable<std::tuple<Ts...>> : std::bool_constant<(comparable<Ts>::value && ...)> {};
+    template <typename T>
+    struct comparable<std::optional<T>> : comparable<T> {};
+    template <typename T, typename Alloc>
+    struct comparable<std::vector<T,Alloc>> : comparable<T> {};
 
-    // Compile time check to see if a type supports hashing using SFINAE
+    // Compile time check to see if a type supports operator== using SFINAE
     template <typename S, typename = void>
-    struct hashable : std::false_type {};
+    struct equality_comparable : std::false_type {};
     template <typename S>
-    struct hashable<S, std::void_t<decltype(std::hash<S>{}(std::declval<S>()))>> : std::true_type {};
+    struct equality_comparable<S, std::void_t<decltype(std::declval<S>() == std::declval<S>())>> : std::true_type {};
+
+    // traits::hashable, which checks if a type supports hashing with mc::Hash, lives in hash.hh along with Hash.
   }
 }
 
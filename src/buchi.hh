@@ -1,14 +1,27 @@
 #ifndef BUCHI_HH
 #define BUCHI_HH
 
-#include <vector>
 #include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "auto_set.hh"
+#include "function_ref.hh"
 
 namespace mc {
 
-  template <typename State, typename Alphabet>
+  /**
+   * A Buchi automaton, given by its initial states, the transitions of each state and which states are accepting.
+   * transitions(state, visit) must call visit(label, next) for every transition of state, and accepting(state) says whether state is accepting.
+   * By default both are type erased std::functions, so that automata defined in different ways have the same type.
+   * An automaton can instead keep the types of its functions as Transitions and Accepting (see MakeBuchi),
+   * which lets the compiler inline them into the searches and into the automata built on top of it, e.g. by Intersection.
+   * Such a Transitions is usually a lambda taking visit as auto const&, so that visit is not type erased either.
+   */
+  template <typename State, typename Alphabet,
+            typename Transitions = std::function<void(State const&, FunctionRef<void(Alphabet const&, State const&)>)>,
+            typename Accepting = std::function<bool(State const&)>>
   class Buchi {
   public:
     using StateType = State;
@@ -16,12 +29,28 @@ namespace mc {
     using StateSet = auto_set<State>;
     using TransitionSet = auto_set<std::pair<Alphabet,State>>;
     using StateTransitions = std::function<TransitionSet(State const&)>;
+    // Receives the label and head of each transition of a state, in turn.
+    using TransitionVisitor = FunctionRef<void(Alphabet const&, State const&)>;
+    // Passes every transition of a state to the visitor instead of collecting them in a TransitionSet.
+    // A state may pass the same transition more than once.
+    using StateTransitionVisitor = std::function<void(State const&, TransitionVisitor)>;
     using StateCharFunc = std::function<bool(State const&)>;
 
 
+    Buchi(StateSet initialStates, Transitions transitions, Accepting acceptingStates)
+      : initialStates(initialStates),
+        transitions(transitions),
+        acceptingStates(acceptingStates)
+      {}
+
+    // Defines the transitions by returning a TransitionSet for every state. Only type erased automata can be defined this way.
     Buchi(StateSet initialStates, StateTransitions stateTransitions, StateCharFunc acceptingStates)
       : initialStates(initialStates),
-        stateTransitions(stateTransitions),
+        transitions([stateTransitions](State const& state, TransitionVisitor visit) {
+          for (auto const& [label, next] : stateTransitions(state)) {
+            visit(label, next);
+          }
+        }),
         acceptingStates(acceptingStates)
       {}
 
@@ -42,7 +71,19 @@ namespace mc {
     }
 
     TransitionSet getTransitions(State const& state) const{
-      return stateTransitions(state);
+      TransitionSet transitionSet;
+      forEachTransition(state, [&transitionSet](Alphabet const& label, State const& next) {
+        transitionSet.emplace(label, next);
+      });
+      return transitionSet;
+    }
+
+    // Calls f(label, next) for each transition of state. The arguments are only valid during the call.
+    // Unlike getTransitions this allocates nothing unless the transitions were defined with a TransitionSet,
+    // but a transition may be visited more than once.
+    template <typename F>
+    void forEachTransition(State const& state, F const& f) const {
+      transitions(state, f);
     }
 
     bool accepting(State const& state) const {
@@ -51,9 +92,26 @@ namespace mc {
 
   private:
     StateSet initialStates;
-    StateTransitions stateTransitions;
-    StateCharFunc acceptingStates;
+    Transitions transitions;
+    Accepting acceptingStates;
   };
 
+  // Builds a Buchi automaton that keeps the types of its transition function and acceptance predicate. See Buchi.
+  template <typename State, typename Alphabet, typename Transitions, typename Accepting>
+  Buchi<State, Alphabet, Transitions, Accepting> MakeBuchi(auto_set<State> initialStates, Transitions transitions, Accepting accepting) {
+    return Buchi<State, Alphabet, Transitions, Accepting>(std::move(initialStates), std::move(transitions), std::move(accepting));
+  }
+
+  // Erases the types of the functions of a Buchi automaton, e.g. to keep automata defined in different ways in the same variable.
+  template <typename S, typename A, typename... Fs>
+  Buchi<S,A> EraseTypes(Buchi<S,A,Fs...> const& buchi) {
+    if constexpr (std::is_same_v<Buchi<S,A,Fs...>, Buchi<S,A>>) {
+      return buchi;
+    } else {
+      return Buchi<S,A>(buchi.getInitialStates(),
+                        [buchi](S const& s, typename Buchi<S,A>::TransitionVisitor visit) { buchi.forEachTransition(s, visit); },
+                        [buchi](S const& s) { return buchi.accepting(s); });
+    }
+  }
 }
 #endif
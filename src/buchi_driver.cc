@@ -1,13 +1,20 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <regex>
 #include <functional>
+#include <optional>
 #include <utility>
 #include <vector>
 
 #include "buchi.hh"
 #include "buchi_utils.hh"
+#include "buchi_search.hh"
+#include "buchi_reduction.hh"
+#include "generalized_buchi.hh"
+#include "state_interner.hh"
+#include "search_option_parser.hh"
 #include "auto_set.hh"
 #include "auto_map.hh"
 
@@ -274,17 +281,60 @@ private:
   std::ifstream stream;
 };
 
+// Searches the intersection of buchi1 and buchi2 for an accepting run and prints what was found.
+template <typename Buchi1, typename Buchi2>
+void CheckIntersection(Buchi1 const& buchi1, Buchi2 const& buchi2, mc::SearchOptions const& searchOptions) {
+  // Intersecting as generalized Buchi automata keeps the acceptance sets of both sides instead of multiplying the states by a counter.
+  // Its states are interned so the search works on integer ids. They are turned back into pairs of states only to print the lasso.
+  auto [buchiIntersection, stateInterner] = mc::InternStates(mc::Intersection(mc::ToGeneralized(buchi1), mc::ToGeneralized(buchi2)));
+  mc::SearchStatistics searchStatistics;
+  auto opt_idLasso = mc::FindAcceptingRun(buchiIntersection, searchOptions, &searchStatistics);
+  if (opt_idLasso) {
+    std::cout << "Intersection is not empty. Lasso:\n";
+    const auto [stem, loop] = mc::MaterializeLasso(*opt_idLasso, *stateInterner);
+    std::cout << "Stem:\n";
+    for (auto [s1, s2] : stem) {
+      std::cout << "(" << s1 << ", " << s2 << ")\n";
+    }
+    std::cout << "\nLoop:\n";
+    for (auto [s1, s2] : loop) {
+      std::cout << "(" << s1 << ", " << s2 << ")\n";
+    }
+  } else if (!searchStatistics.complete) {
+    std::cout << "No lasso was found, but the search was incomplete so the intersection may not be empty.\n";
+  } else {
+    std::cout << "Intersection of Buchis is empty.\n";
+  }
+  parser::PrintSearchStatistics(searchOptions, searchStatistics);
+}
+
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cout << "Expected input: <buchi_filename>\n";
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::optional<mc::Simulation> opt_reduction;
+  if (auto reduceIter = std::find(args.begin(), args.end(), "--reduce"); reduceIter != args.end()) {
+    std::string simulation = (reduceIter + 1 == args.end()) ? "" : *(reduceIter + 1);
+    if (simulation == "direct") {
+      opt_reduction = mc::Simulation::Direct;
+    } else if (simulation == "delayed") {
+      opt_reduction = mc::Simulation::Delayed;
+    } else {
+      std::cout << "Expected direct or delayed after --reduce.\n";
+      return -1;
+    }
+    args.erase(reduceIter, reduceIter + 2);
+  }
+  mc::SearchOptions searchOptions;
+  if (!parser::ParseSearchOptions(args, searchOptions) || args.size() != 1) {
+    std::cout << "Expected input: <buchi_filename> [--reduce <direct|delayed>] [search options]\n";
+    std::cout << "--reduce removes the states of both automata that cannot reach an accepting cycle and merges those that simulate each other\n";
+    std::cout << "before they are intersected.\n";
+    parser::PrintSearchOptionsUsage();
     return -1;
   }
-
-  BuchiParser parser (argv[1]);
+  BuchiParser parser (args[0].c_str());
   if (!parser.ParseSuccessful()) {
     return -1;
   }
-
   using StringBuchi = mc::Buchi<std::string,std::string>;
   std::optional<std::pair<StringBuchi,StringBuchi>> opt_buchis;
   try {
@@ -296,23 +346,18 @@ int main(int argc, char* argv[]) {
     return -1;
   }
   auto [buchi1, buchi2] = *opt_buchis;
-  auto buchiIntersection = mc::Intersection(buchi1, buchi2);
-
-  auto opt_lasso = mc::FindAcceptingRun(buchiIntersection);
-  if (opt_lasso) {
-    std::cout << "Intersection is not empty. Lasso:\n";
-    const auto& [stem, loop] = *opt_lasso;
-    std::cout << "Stem:\n";
-    for (auto [s1, s2, x] : stem) {
-      std::cout << "(" << s1 << ", " << s2 << ", " << x << ")\n";
-    }
-    std::cout << "\nLoop:\n";
-    for (auto [s1, s2, x] : loop) {
-      std::cout << "(" << s1 << ", " << s2 << ", " << x << ")\n";
-    }
-  } else {
-    std::cout << "Intersection of Buchis is empty.\n";
+  if (!opt_reduction) {
+    CheckIntersection(buchi1, buchi2, searchOptions);
+    return 0;
   }
-
+  mc::ReductionStatistics reduction1;
+  mc::ReductionStatistics reduction2;
+  auto reduced1 = mc::ReduceBuchi(buchi1, *opt_reduction, &reduction1);
+  auto reduced2 = mc::ReduceBuchi(buchi2, *opt_reduction, &reduction2);
+  for (auto const& [name, reduction] : {std::make_pair("First", reduction1), std::make_pair("Second", reduction2)}) {
+    std::cout << name << " Buchi: " << reduction.statesBefore << " states and " << reduction.transitionsBefore << " transitions reduced to "
+              << reduction.statesAfter << " states and " << reduction.transitionsAfter << " transitions.\n";
+  }
+  CheckIntersection(reduced1, reduced2, searchOptions);
   return 0;
 }
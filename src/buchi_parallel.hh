@@ -0,0 +1,239 @@
+#ifndef BUCHI_PARALLEL_HH
+#define BUCHI_PARALLEL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "auto_set.hh"
+#include "auto_map.hh"
+#include "buchi.hh"
+#include "buchi_utils.hh"
+#include "concurrent_set.hh"
+#include "search_arena.hh"
+
+namespace mc {
+  namespace _details_ {
+    // The data all CNDFS workers share: the red states, which are known not to lie on an accepting cycle, and the first lasso found.
+    template <typename S>
+    struct CNDFSShared {
+      concurrent_set<S> red;
+      std::atomic<bool> stop = false;
+      std::mutex resultMutex;
+      std::optional<Lasso<S>> result;
+      std::exception_ptr error;
+
+      void report(Lasso<S>&& lasso) {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if (!result) {
+          result = std::move(lasso);
+        }
+        stop = true;
+      }
+    };
+
+    // A single worker of the CNDFS algorithm (Evangelista et al., "Improved Multi-Core Nested Depth-First Search").
+    // Each worker runs its own nested DFS with its own successor order. Blue and cyan colors are local to the worker,
+    // while red states are shared so that workers prune the parts of the automaton other workers have already proven to be free of accepting cycles.
+    template <typename B>
+    class CNDFSWorker {
+    public:
+      using S = typename B::StateType;
+
+      CNDFSWorker(B const& buchi, CNDFSShared<S>& shared, size_t id)
+        : buchi(buchi),
+          shared(shared),
+          id(id),
+          rng(id),
+          cyan(arena.resource()),
+          blue(arena.resource()),
+          blueFrames(arena.resource())
+        {}
+
+      void run() {
+        std::vector<S> initStates(buchi.getInitialStates().begin(), buchi.getInitialStates().end());
+        shuffle(initStates);
+        for (auto const& initState : initStates) {
+          if (shared.stop) {
+            return;
+          }
+          if (blue.count(initState) == 0 && !shared.red.contains(initState)) {
+            blueSearch(initState);
+          }
+        }
+        // A worker that completes its search without finding an accepting cycle has proven that there is none.
+        shared.stop = true;
+      }
+
+    private:
+      // Worker 0 keeps the natural successor order. Every other worker explores successors in its own random order so the workers spread out over the automaton.
+      void shuffle(std::vector<S>& states) {
+        if (id != 0) {
+          std::shuffle(states.begin(), states.end(), rng);
+        }
+      }
+
+      void push(DFSStack<S>& frames, S const& state) {
+        frames.push(buchi, state);
+        if (id != 0) {
+          frames.shuffleTop(rng);
+        }
+      }
+
+      void pushBlue(S const& state) {
+        cyan.emplace(state, blueFrames.size());
+        push(blueFrames, state);
+      }
+
+      // The states of the blue stack from position `from` onwards.
+      std::vector<S> blueStackFrom(size_t from) const {
+        std::vector<S> states;
+        for (size_t i = from; i < blueFrames.size(); ++i) {
+          states.emplace_back(blueFrames[i]);
+        }
+        return states;
+      }
+
+      void blueSearch(S const& initState) {
+        pushBlue(initState);
+        while (!blueFrames.empty()) {
+          if (shared.stop) {
+            return;
+          }
+          S const& state = blueFrames.top();
+          if (!blueFrames.done()) {
+            S next = blueFrames.nextSuccessor();
+            auto cyanIter = cyan.find(next);
+            if (cyanIter != cyan.end()) {
+              if (buchi.accepting(state) || buchi.accepting(next)) {
+                // next -> ... -> state -> next is a cycle on the blue stack through an accepting state.
+                size_t cycleStart = cyanIter->second;
+                std::vector<S> stem = blueStackFrom(0);
+                stem.resize(cycleStart);
+                shared.report(std::make_pair(stem, blueStackFrom(cycleStart)));
+                return;
+              }
+            } else if (blue.count(next) == 0 && !shared.red.contains(next)) {
+              pushBlue(next);
+            }
+            continue;
+          }
+
+          if (buchi.accepting(state) && !redSearch(state)) {
+            return;
+          }
+          blue.insert(state);
+          cyan.erase(state);
+          blueFrames.pop();
+        }
+      }
+
+      // Searches for a cycle back to the blue stack from the accepting state seed, which is on top of the blue stack.
+      // Returns false if the search was stopped, either because a lasso was found or because another worker finished.
+      bool redSearch(S const& seed) {
+        pmr::auto_set<S> pink(arena.resource());
+        DFSStack<S> redFrames(arena.resource());
+        pink.insert(seed);
+        push(redFrames, seed);
+
+        while (!redFrames.empty()) {
+          if (shared.stop) {
+            return false;
+          }
+          if (!redFrames.done()) {
+            S next = redFrames.nextSuccessor();
+            auto cyanIter = cyan.find(next);
+            if (cyanIter != cyan.end()) {
+              size_t cycleStart = cyanIter->second;
+              std::vector<S> stem = blueStackFrom(0);
+              stem.resize(cycleStart);
+              std::vector<S> loop = blueStackFrom(cycleStart);
+              for (size_t depth = 1; depth < redFrames.size(); ++depth) {
+                loop.emplace_back(redFrames[depth]);
+              }
+              shared.report(std::make_pair(stem, loop));
+              return false;
+            }
+            if (pink.count(next) == 0 && !shared.red.contains(next)) {
+              pink.insert(next);
+              push(redFrames, next);
+            }
+            continue;
+          }
+          redFrames.pop();
+        }
+
+        // Other workers may still be running red searches from accepting states we passed through.
+        // Wait for them to finish before marking our states red, otherwise we could prune a cycle they are about to find.
+        for (auto const& state : pink) {
+          if (state == seed || !buchi.accepting(state)) {
+            continue;
+          }
+          while (!shared.red.contains(state)) {
+            if (shared.stop) {
+              return false;
+            }
+            std::this_thread::yield();
+          }
+        }
+        for (auto const& state : pink) {
+          shared.red.insert(state);
+        }
+        return true;
+      }
+
+      B const& buchi;
+      CNDFSShared<S>& shared;
+      size_t id;
+      std::mt19937_64 rng;
+
+      // The worker's own memory, so that workers do not contend on the allocator. The red states are shared and not kept here.
+      SearchArena arena;
+      // Maps every cyan state (i.e. every state on the blue stack) to its position on the blue stack.
+      pmr::auto_map<S,size_t> cyan;
+      pmr::auto_set<S> blue;
+      DFSStack<S> blueFrames;
+    };
+  }
+
+  // Searches a Buchi automaton for an accepting run with the CNDFS algorithm running on numThreads threads.
+  // If numThreads is 0 then one thread per hardware thread is used.
+  // Returns a lasso of the same shape as FindAcceptingRun, or std::nullopt if the Buchi's language is empty.
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRunParallel(Buchi<S,A,Fs...> const& buchi, size_t numThreads) {
+    if (numThreads == 0) {
+      numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    _details_::CNDFSShared<S> shared;
+    std::vector<std::thread> workers;
+    for (size_t id = 0; id < numThreads; ++id) {
+      workers.emplace_back([&buchi, &shared, id]() {
+        try {
+          _details_::CNDFSWorker<Buchi<S,A,Fs...>>(buchi, shared, id).run();
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(shared.resultMutex);
+          shared.error = std::current_exception();
+          shared.stop = true;
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    if (shared.error) {
+      std::rethrow_exception(shared.error);
+    }
+    return shared.result;
+  }
+}
+
+#endif
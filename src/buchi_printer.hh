@@ -27,8 +27,8 @@ namespace mc {
     }
   }
 
-  template <typename S, typename A>
-  void PrintBuchi(std::ostream& out, Buchi<S,A> const& buchi,
+  template <typename S, typename A, typename... Fs>
+  void PrintBuchi(std::ostream& out, Buchi<S,A,Fs...> const& buchi,
                   std::function<std::string(A)> alphabetToString = _details_::genericToString<A>,
                   std::function<std::string(S)> stateToString = _details_::genericToString<S>) {
     auto_set<S> closed;
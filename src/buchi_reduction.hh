@@ -0,0 +1,474 @@
+#ifndef BUCHI_REDUCTION_HH
+#define BUCHI_REDUCTION_HH
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "auto_set.hh"
+#include "auto_map.hh"
+#include "buchi.hh"
+#include "generalized_buchi.hh"
+
+namespace mc {
+  // The simulation a reduction merges states by.
+  enum class Simulation {
+    // r simulates q if r can answer every move of q with the same label, and is accepting (in every acceptance set) whenever q is.
+    // Merging and pruning by it is cheap and works for generalized automata as well.
+    Direct,
+    // As Direct, but r may visit an accepting state some time after q does instead of at the same time. Relates more states,
+    // but solving its game costs more and it only applies to automata with a single acceptance set.
+    Delayed
+  };
+
+  // The size of an automaton before and after its reduction. Only the states reachable from the initial states are counted.
+  struct ReductionStatistics {
+    size_t statesBefore = 0;
+    size_t transitionsBefore = 0;
+    size_t statesAfter = 0;
+    size_t transitionsAfter = 0;
+  };
+
+  namespace _details_ {
+    // An automaton stored explicitly, its states numbered in the order they were found.
+    template <typename S, typename A>
+    struct ExplicitAutomaton {
+      size_t size() const {
+        return states.size();
+      }
+
+      size_t numTransitions() const {
+        size_t count = 0;
+        for (auto const& stateTransitions : transitions) {
+          count += stateTransitions.size();
+        }
+        return count;
+      }
+
+      std::vector<S> states;
+      auto_map<S, size_t> index;
+      // The label of every transition, numbered so that labels are compared as integers.
+      std::vector<A> labels;
+      std::vector<std::vector<std::pair<size_t, size_t>>> transitions;
+      std::vector<AcceptanceMarks> marks;
+      std::vector<size_t> initialStates;
+      size_t numAcceptanceSets = 0;
+    };
+
+    // Stores the part of automaton reachable from its initial states, dropping transitions that are visited more than once.
+    template <typename S, typename A, typename Automaton, typename MarksOf>
+    ExplicitAutomaton<S,A> Explore(Automaton const& automaton, size_t numAcceptanceSets, MarksOf const& marksOf) {
+      ExplicitAutomaton<S,A> explicitAutomaton;
+      explicitAutomaton.numAcceptanceSets = numAcceptanceSets;
+      auto_map<A, size_t> labelIds;
+      auto IndexOf = [&](S const& state) {
+        auto [iter, inserted] = explicitAutomaton.index.emplace(state, explicitAutomaton.states.size());
+        if (inserted) {
+          explicitAutomaton.states.emplace_back(state);
+        }
+        return iter->second;
+      };
+      for (auto const& init : automaton.getInitialStates()) {
+        explicitAutomaton.initialStates.emplace_back(IndexOf(init));
+      }
+      // states grows while it is being walked, which makes this a breadth first search.
+      for (size_t i = 0; i < explicitAutomaton.states.size(); ++i) {
+        S state = explicitAutomaton.states[i];
+        std::vector<std::pair<size_t, size_t>> stateTransitions;
+        automaton.forEachTransition(state, [&](A const& label, S const& next) {
+          auto [labelIter, inserted] = labelIds.emplace(label, explicitAutomaton.labels.size());
+          if (inserted) {
+            explicitAutomaton.labels.emplace_back(label);
+          }
+          std::pair<size_t, size_t> transition(labelIter->second, IndexOf(next));
+          if (std::find(stateTransitions.begin(), stateTransitions.end(), transition) == stateTransitions.end()) {
+            stateTransitions.emplace_back(transition);
+          }
+        });
+        explicitAutomaton.transitions.emplace_back(std::move(stateTransitions));
+        explicitAutomaton.marks.emplace_back(marksOf(state));
+      }
+      return explicitAutomaton;
+    }
+
+    // The states from which some run visits every acceptance set infinitely often,
+    // i.e. those that can reach a cycle within one strongly connected component whose states cover every acceptance set.
+    template <typename S, typename A>
+    std::vector<bool> LiveStates(ExplicitAutomaton<S,A> const& automaton) {
+      size_t n = automaton.size();
+      AcceptanceMarks allMarks;
+      for (size_t c = 0; c < automaton.numAcceptanceSets; ++c) {
+        allMarks.set(c);
+      }
+
+      // Tarjan's algorithm, iteratively. A state's component is only known once the DFS leaves its root.
+      constexpr size_t Unvisited = static_cast<size_t>(-1);
+      std::vector<size_t> dfsNumber(n, Unvisited);
+      std::vector<size_t> lowLink(n);
+      std::vector<bool> onStack(n, false);
+      std::vector<size_t> sccStack;
+      std::vector<bool> live(n, false);
+      size_t nextNumber = 0;
+      for (size_t root = 0; root < n; ++root) {
+        if (dfsNumber[root] != Unvisited) {
+          continue;
+        }
+        // Each entry is a state and the index of its next transition to follow.
+        std::vector<std::pair<size_t, size_t>> callStack{{root, 0}};
+        dfsNumber[root] = lowLink[root] = nextNumber++;
+        sccStack.emplace_back(root);
+        onStack[root] = true;
+        while (!callStack.empty()) {
+          auto& [state, transition] = callStack.back();
+          if (transition < automaton.transitions[state].size()) {
+            size_t next = automaton.transitions[state][transition++].second;
+            if (dfsNumber[next] == Unvisited) {
+              dfsNumber[next] = lowLink[next] = nextNumber++;
+              sccStack.emplace_back(next);
+              onStack[next] = true;
+              callStack.emplace_back(next, 0);
+            } else if (onStack[next]) {
+              lowLink[state] = std::min(lowLink[state], dfsNumber[next]);
+            }
+            continue;
+          }
+          size_t finished = state;
+          callStack.pop_back();
+          if (!callStack.empty()) {
+            lowLink[callStack.back().first] = std::min(lowLink[callStack.back().first], lowLink[finished]);
+          }
+          if (lowLink[finished] != dfsNumber[finished]) {
+            continue;
+          }
+          // finished is the root of a component, which is accepting if it has a cycle covering every acceptance set.
+          std::vector<size_t> component;
+          size_t member;
+          do {
+            member = sccStack.back();
+            sccStack.pop_back();
+            onStack[member] = false;
+            component.emplace_back(member);
+          } while (member != finished);
+          AcceptanceMarks marks;
+          for (size_t s : component) {
+            marks |= automaton.marks[s];
+          }
+          auto const& finishedTransitions = automaton.transitions[finished];
+          bool cyclic = component.size() > 1 || std::any_of(finishedTransitions.begin(), finishedTransitions.end(), [finished](auto const& t) {
+            return t.second == finished;
+          });
+          if (cyclic && (marks & allMarks) == allMarks) {
+            for (size_t s : component) {
+              live[s] = true;
+            }
+          }
+        }
+      }
+
+      // Every state that can reach an accepting component is live as well.
+      std::vector<std::vector<size_t>> predecessors(n);
+      for (size_t s = 0; s < n; ++s) {
+        for (auto const& [_, next] : automaton.transitions[s]) {
+          predecessors[next].emplace_back(s);
+        }
+      }
+      std::vector<size_t> queue;
+      for (size_t s = 0; s < n; ++s) {
+        if (live[s]) {
+          queue.emplace_back(s);
+        }
+      }
+      while (!queue.empty()) {
+        size_t s = queue.back();
+        queue.pop_back();
+        for (size_t p : predecessors[s]) {
+          if (!live[p]) {
+            live[p] = true;
+            queue.emplace_back(p);
+          }
+        }
+      }
+      return live;
+    }
+
+    // Whether the transitions of q can all be answered by transitions of r with the same label into states related by sim.
+    // related(q', r') says whether r' answers q'.
+    template <typename S, typename A, typename Related>
+    bool CanAnswer(ExplicitAutomaton<S,A> const& automaton, size_t q, size_t r, Related const& related) {
+      auto const& rTransitions = automaton.transitions[r];
+      return std::all_of(automaton.transitions[q].begin(), automaton.transitions[q].end(), [&](auto const& qTransition) {
+        return std::any_of(rTransitions.begin(), rTransitions.end(), [&](auto const& rTransition) {
+          return rTransition.first == qTransition.first && related(qTransition.second, rTransition.second);
+        });
+      });
+    }
+
+    // sim[q][r] is whether r directly simulates q. Starts from every pair allowed by the acceptance sets and removes pairs until none fail.
+    template <typename S, typename A>
+    std::vector<std::vector<bool>> DirectSimulation(ExplicitAutomaton<S,A> const& automaton) {
+      size_t n = automaton.size();
+      std::vector<std::vector<bool>> sim(n, std::vector<bool>(n));
+      for (size_t q = 0; q < n; ++q) {
+        for (size_t r = 0; r < n; ++r) {
+          sim[q][r] = (automaton.marks[q] & ~automaton.marks[r]).none();
+        }
+      }
+      bool changed = true;
+      while (changed) {
+        changed = false;
+        for (size_t q = 0; q < n; ++q) {
+          for (size_t r = 0; r < n; ++r) {
+            if (sim[q][r] && !CanAnswer(automaton, q, r, [&sim](size_t q2, size_t r2) { return sim[q2][r2]; })) {
+              sim[q][r] = false;
+              changed = true;
+            }
+          }
+        }
+      }
+      return sim;
+    }
+
+    // sim[q][r] is whether r delayed simulates q, for an automaton with a single acceptance set.
+    // Solves the delayed simulation game, a Buchi game on positions (q, r, pending) where pending means q has visited an accepting state
+    // that r has not yet matched. r wins if pending is false infinitely often.
+    template <typename S, typename A>
+    std::vector<std::vector<bool>> DelayedSimulation(ExplicitAutomaton<S,A> const& automaton) {
+      size_t n = automaton.size();
+      auto Accepting = [&automaton](size_t s) {
+        return automaton.marks[s].test(0);
+      };
+      auto Position = [n](size_t q, size_t r, bool pending) {
+        return (q * n + r) * 2 + pending;
+      };
+      // Whether r can answer every move of q so that the game continues in winning.
+      auto ControllablePredecessor = [&](std::vector<bool> const& winning, size_t q, size_t r, bool pending) {
+        return CanAnswer(automaton, q, r, [&](size_t q2, size_t r2) {
+          bool pending2 = !Accepting(r2) && (Accepting(q2) || pending);
+          return static_cast<bool>(winning[Position(q2, r2, pending2)]);
+        });
+      };
+
+      // The greatest fixpoint of the positions from which r can force its way to a position without a pending visit,
+      // from which it can do so again.
+      std::vector<bool> outer(2 * n * n, true);
+      bool outerChanged = true;
+      while (outerChanged) {
+        std::vector<bool> inner(2 * n * n, false);
+        bool innerChanged = true;
+        while (innerChanged) {
+          innerChanged = false;
+          for (size_t q = 0; q < n; ++q) {
+            for (size_t r = 0; r < n; ++r) {
+              for (bool pending : {false, true}) {
+                size_t p = Position(q, r, pending);
+                if (!inner[p] && ((!pending && ControllablePredecessor(outer, q, r, pending)) || ControllablePredecessor(inner, q, r, pending))) {
+                  inner[p] = true;
+                  innerChanged = true;
+                }
+              }
+            }
+          }
+        }
+        outerChanged = (inner != outer);
+        outer = std::move(inner);
+      }
+
+      std::vector<std::vector<bool>> sim(n, std::vector<bool>(n));
+      for (size_t q = 0; q < n; ++q) {
+        for (size_t r = 0; r < n; ++r) {
+          sim[q][r] = outer[Position(q, r, Accepting(q) && !Accepting(r))];
+        }
+      }
+      return sim;
+    }
+
+    // Merges the states that simulate each other into one, the first of them, and drops the initial states some other initial state simulates.
+    // With direct simulation a transition is also dropped if its state has a transition with the same label to a state that simulates its target.
+    template <typename S, typename A>
+    ExplicitAutomaton<S,A> Quotient(ExplicitAutomaton<S,A> const& automaton, std::vector<std::vector<bool>> const& sim, Simulation simulation) {
+      size_t n = automaton.size();
+      std::vector<size_t> classOf(n);
+      std::vector<size_t> representatives;
+      for (size_t s = 0; s < n; ++s) {
+        auto iter = std::find_if(representatives.begin(), representatives.end(), [&](size_t r) { return sim[s][r] && sim[r][s]; });
+        classOf[s] = iter - representatives.begin();
+        if (iter == representatives.end()) {
+          representatives.emplace_back(s);
+        }
+      }
+      // Distinct classes that simulate each other one way only.
+      auto StrictlySimulates = [&](size_t c1, size_t c2) {
+        return c1 != c2 && sim[representatives[c2]][representatives[c1]];
+      };
+      auto DropSimulated = [&](std::vector<std::pair<size_t, size_t>>& transitions) {
+        std::vector<std::pair<size_t, size_t>> kept;
+        for (auto const& t : transitions) {
+          bool simulated = std::any_of(transitions.begin(), transitions.end(), [&](auto const& other) {
+            return other.first == t.first && StrictlySimulates(other.second, t.second);
+          });
+          if (!simulated) {
+            kept.emplace_back(t);
+          }
+        }
+        transitions = std::move(kept);
+      };
+
+      ExplicitAutomaton<S,A> quotient;
+      quotient.labels = automaton.labels;
+      quotient.numAcceptanceSets = automaton.numAcceptanceSets;
+      quotient.transitions.resize(representatives.size());
+      quotient.marks.resize(representatives.size());
+      for (size_t r : representatives) {
+        quotient.index.emplace(automaton.states[r], quotient.states.size());
+        quotient.states.emplace_back(automaton.states[r]);
+      }
+      // A class has the transitions and acceptance sets of all its states.
+      for (size_t s = 0; s < n; ++s) {
+        auto& classTransitions = quotient.transitions[classOf[s]];
+        for (auto const& [label, next] : automaton.transitions[s]) {
+          std::pair<size_t, size_t> transition(label, classOf[next]);
+          if (std::find(classTransitions.begin(), classTransitions.end(), transition) == classTransitions.end()) {
+            classTransitions.emplace_back(transition);
+          }
+        }
+        quotient.marks[classOf[s]] |= automaton.marks[s];
+      }
+      if (simulation == Simulation::Direct) {
+        for (auto& classTransitions : quotient.transitions) {
+          DropSimulated(classTransitions);
+        }
+      }
+      // Simulation implies language inclusion, for delayed simulation too, so a simulated initial state adds no words.
+      std::vector<size_t> initialClasses;
+      for (size_t init : automaton.initialStates) {
+        if (std::find(initialClasses.begin(), initialClasses.end(), classOf[init]) == initialClasses.end()) {
+          initialClasses.emplace_back(classOf[init]);
+        }
+      }
+      for (size_t c : initialClasses) {
+        if (std::none_of(initialClasses.begin(), initialClasses.end(), [&](size_t other) { return StrictlySimulates(other, c); })) {
+          quotient.initialStates.emplace_back(c);
+        }
+      }
+      return quotient;
+    }
+
+    // Lets Explore walk an explicit automaton like any other.
+    template <typename S, typename A>
+    struct ExplicitView {
+      auto_set<S> getInitialStates() const {
+        auto_set<S> initialStates;
+        for (size_t init : automaton.initialStates) {
+          initialStates.insert(automaton.states[init]);
+        }
+        return initialStates;
+      }
+
+      template <typename F>
+      void forEachTransition(S const& state, F const& f) const {
+        auto iter = automaton.index.find(state);
+        if (iter == automaton.index.end()) {
+          return;
+        }
+        for (auto const& [label, next] : automaton.transitions[iter->second]) {
+          f(automaton.labels[label], automaton.states[next]);
+        }
+      }
+
+      ExplicitAutomaton<S,A> const& automaton;
+    };
+
+    // Keeps the live states of automaton, merges them by simulation and drops the states the merged initial states no longer reach.
+    template <typename S, typename A>
+    ExplicitAutomaton<S,A> Reduce(ExplicitAutomaton<S,A> const& automaton, Simulation simulation, ReductionStatistics* statistics) {
+      std::vector<bool> live = LiveStates(automaton);
+      // The live part, with the states renumbered.
+      ExplicitAutomaton<S,A> pruned;
+      pruned.labels = automaton.labels;
+      pruned.numAcceptanceSets = automaton.numAcceptanceSets;
+      std::vector<size_t> prunedIndex(automaton.size());
+      for (size_t s = 0; s < automaton.size(); ++s) {
+        if (live[s]) {
+          prunedIndex[s] = pruned.states.size();
+          pruned.index.emplace(automaton.states[s], pruned.states.size());
+          pruned.states.emplace_back(automaton.states[s]);
+          pruned.marks.emplace_back(automaton.marks[s]);
+        }
+      }
+      for (size_t s = 0; s < automaton.size(); ++s) {
+        if (!live[s]) {
+          continue;
+        }
+        auto& stateTransitions = pruned.transitions.emplace_back();
+        for (auto const& [label, next] : automaton.transitions[s]) {
+          if (live[next]) {
+            stateTransitions.emplace_back(label, prunedIndex[next]);
+          }
+        }
+      }
+      for (size_t init : automaton.initialStates) {
+        if (live[init]) {
+          pruned.initialStates.emplace_back(prunedIndex[init]);
+        }
+      }
+
+      auto sim = (simulation == Simulation::Delayed) ? DelayedSimulation(pruned) : DirectSimulation(pruned);
+      ExplicitAutomaton<S,A> quotient = Quotient(pruned, sim, simulation);
+      // Dropping initial states and transitions may leave states unreachable.
+      ExplicitAutomaton<S,A> reduced = Explore<S,A>(ExplicitView<S,A>{quotient}, quotient.numAcceptanceSets,
+                                                    [&quotient](S const& s) { return quotient.marks[quotient.index.at(s)]; });
+      if (statistics != nullptr) {
+        statistics->statesBefore = automaton.size();
+        statistics->transitionsBefore = automaton.numTransitions();
+        statistics->statesAfter = reduced.size();
+        statistics->transitionsAfter = reduced.numTransitions();
+      }
+      return reduced;
+    }
+
+  }
+
+  /**
+   * Reduces a Buchi automaton before it is intersected with another. Only the states reachable from the initial states are considered,
+   * and of those the states that cannot reach an accepting cycle are removed. The rest are merged when they simulate each other,
+   * with transitions and initial states made redundant by the simulation dropped (see Simulation). The language stays the same.
+   * The result is stored explicitly, and its states are those of buchi that stand for each merged group.
+   */
+  template <typename S, typename A, typename... Fs>
+  auto ReduceBuchi(Buchi<S,A,Fs...> const& buchi, Simulation simulation = Simulation::Direct, ReductionStatistics* statistics = nullptr) {
+    auto explicitBuchi = _details_::Explore<S,A>(buchi, 1, [&buchi](S const& s) { return AcceptanceMarks(buchi.accepting(s) ? 1 : 0); });
+    // Shared so that copies of the automaton do not copy the transitions.
+    auto reduced = std::make_shared<_details_::ExplicitAutomaton<S,A> const>(_details_::Reduce(explicitBuchi, simulation, statistics));
+    auto_set<S> initialStates = _details_::ExplicitView<S,A>{*reduced}.getInitialStates();
+
+    auto transitions = [reduced](S const& s, auto const& visit) {
+      _details_::ExplicitView<S,A>{*reduced}.forEachTransition(s, visit);
+    };
+    auto accepting = [reduced](S const& s) {
+      auto iter = reduced->index.find(s);
+      return iter != reduced->index.end() && reduced->marks[iter->second].test(0);
+    };
+    return MakeBuchi<S,A>(std::move(initialStates), transitions, accepting);
+  }
+
+  // As ReduceBuchi, for generalized Buchi automata. Only direct simulation applies, where a state has to be in every acceptance set
+  // the state it simulates is in.
+  template <typename S, typename A, typename... Fs>
+  auto ReduceGeneralizedBuchi(GeneralizedBuchi<S,A,Fs...> const& gBuchi, ReductionStatistics* statistics = nullptr) {
+    auto explicitBuchi = _details_::Explore<S,A>(gBuchi, gBuchi.getNumAcceptanceSets(), [&gBuchi](S const& s) { return gBuchi.getMarks(s); });
+    auto reduced = std::make_shared<_details_::ExplicitAutomaton<S,A> const>(_details_::Reduce(explicitBuchi, Simulation::Direct, statistics));
+    auto_set<S> initialStates = _details_::ExplicitView<S,A>{*reduced}.getInitialStates();
+
+    auto transitions = [reduced](S const& s, auto const& visit) {
+      _details_::ExplicitView<S,A>{*reduced}.forEachTransition(s, visit);
+    };
+    auto marks = [reduced](S const& s) {
+      auto iter = reduced->index.find(s);
+      return iter != reduced->index.end() ? reduced->marks[iter->second] : AcceptanceMarks();
+    };
+    return MakeGeneralizedBuchi<S,A>(std::move(initialStates), transitions, reduced->numAcceptanceSets, marks);
+  }
+}
+
+#endif
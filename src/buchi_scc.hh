@@ -0,0 +1,182 @@
+#ifndef BUCHI_SCC_HH
+#define BUCHI_SCC_HH
+
+#include <vector>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+
+#include "buchi.hh"
+#include "buchi_utils.hh"
+#include "generalized_buchi.hh"
+#include "auto_set.hh"
+#include "auto_map.hh"
+#include "search_arena.hh"
+
+namespace mc {
+  namespace _details_ {
+    // An entry of the root stack in Couvreur's algorithm.
+    // Each entry is the root of a partial SCC that is still being explored, along with the acceptance marks of all the states in that partial SCC.
+    template <typename S>
+    struct SCCRoot {
+      size_t dfsNumber;
+      S state;
+      AcceptanceMarks marks;
+    };
+
+    // Breadth first search for a path of at least one transition from `from` to a state satisfying isTarget, only passing through states in `within`.
+    // The returned path starts with `from` and ends with the target. It is empty if there is no such path.
+    template <typename S, typename B, typename P>
+    std::vector<S> ShortestPath(B const& automaton, S const& from, P const& isTarget, auto_set<S> const& within) {
+      auto_map<S,S> parents;
+      std::deque<S> queue;
+
+      auto visit = [&](S const& parent) {
+        return [&, parent](auto const&, S const& next) {
+          if (within.count(next) == 1 && parents.count(next) == 0) {
+            parents.emplace(next, parent);
+            queue.emplace_back(next);
+          }
+        };
+      };
+
+      automaton.forEachTransition(from, visit(from));
+      while (!queue.empty()) {
+        S current = queue.front();
+        queue.pop_front();
+        if (isTarget(current)) {
+          std::deque<S> path {current};
+          do {
+            path.emplace_front(parents.at(path.front()));
+          } while (!(path.front() == from));
+          return std::vector<S>(path.begin(), path.end());
+        }
+        automaton.forEachTransition(current, visit(current));
+      }
+      return {};
+    }
+
+    // Builds the lasso for an accepting SCC found by Couvreur's algorithm.
+    // The stem is the DFS path to the root of the SCC and the loop goes from the root through a state of every required acceptance set and back.
+    template <typename S, typename B, typename MarksOf>
+    Lasso<S> SCCLasso(B const& automaton, MarksOf const& marksOf, AcceptanceMarks const& allMarks,
+                      DFSStack<S> const& frames, std::pmr::vector<S> const& active, S const& root) {
+      // The states of the SCC are exactly the active states from the root onwards.
+      auto rootIter = active.end();
+      do {
+        --rootIter;
+      } while (!(*rootIter == root));
+      auto_set<S> scc (rootIter, active.end());
+
+      std::vector<S> stem;
+      for (size_t depth = 0; depth < frames.size() && !(frames[depth] == root); ++depth) {
+        stem.emplace_back(frames[depth]);
+      }
+
+      std::vector<S> loop {root};
+      AcceptanceMarks covered = marksOf(root) & allMarks;
+      while (covered != allMarks) {
+        auto toMissing = ShortestPath(automaton, loop.back(), [&](S const& s) {
+          return (marksOf(s) & allMarks & ~covered).any();
+        }, scc);
+        loop.insert(loop.end(), toMissing.begin() + 1, toMissing.end());
+        covered |= marksOf(loop.back()) & allMarks;
+      }
+      auto toRoot = ShortestPath(automaton, loop.back(), [&root](S const& s) { return s == root; }, scc);
+      loop.insert(loop.end(), toRoot.begin() + 1, toRoot.end() - 1);
+      return std::make_pair(stem, loop);
+    }
+
+    // Couvreur's on-the-fly SCC algorithm over any automaton with getInitialStates and forEachTransition.
+    // marksOf gives the acceptance marks of a state and a cycle is accepting once its SCC has collected all of allMarks.
+    template <typename S, typename B, typename MarksOf>
+    std::optional<Lasso<S>> CouvreurSearch(B const& automaton, MarksOf const& marksOf, AcceptanceMarks const& allMarks) {
+      SearchArena arena;
+      // DFS numbers of every visited state. States whose SCC has been fully explored are reset to 0.
+      pmr::auto_map<S,size_t> dfsNumbers(arena.resource());
+      // Visited states whose SCC has not been fully explored yet, in DFS order.
+      std::pmr::vector<S> active(arena.resource());
+      std::pmr::vector<SCCRoot<S>> roots(arena.resource());
+      DFSStack<S> frames(arena.resource());
+      size_t count = 0;
+
+      auto push = [&](S const& q) {
+        dfsNumbers[q] = ++count;
+        active.emplace_back(q);
+        roots.push_back({count, q, marksOf(q) & allMarks});
+        frames.push(automaton, q);
+      };
+
+      for (auto& initState : automaton.getInitialStates()) {
+        if (dfsNumbers.count(initState) == 1) {
+          continue;
+        }
+        push(initState);
+
+        while (!frames.empty()) {
+          if (!frames.done()) {
+            S next = frames.nextSuccessor();
+            auto numberIter = dfsNumbers.find(next);
+            if (numberIter == dfsNumbers.end()) {
+              push(next);
+              continue;
+            }
+            size_t nextNumber = numberIter->second;
+            if (nextNumber == 0) {
+              continue;
+            }
+            // next is on a cycle with the current state so merge every partial SCC above next into one.
+            AcceptanceMarks marks;
+            while (nextNumber < roots.back().dfsNumber) {
+              marks |= roots.back().marks;
+              roots.pop_back();
+            }
+            roots.back().marks |= marks;
+            if (roots.back().marks == allMarks) {
+              return std::make_optional(SCCLasso(automaton, marksOf, allMarks, frames, active, roots.back().state));
+            }
+            continue;
+          }
+
+          S const& state = frames.top();
+          if (roots.back().state == state) {
+            // state is the root of a complete SCC which contains no accepting cycle. Remove it from the search.
+            roots.pop_back();
+            bool removedRoot = false;
+            while (!removedRoot) {
+              removedRoot = active.back() == state;
+              dfsNumbers[active.back()] = 0;
+              active.pop_back();
+            }
+          }
+          frames.pop();
+        }
+      }
+      return std::nullopt;
+    }
+  }
+
+  // Searches a Buchi automaton for an accepting run using Couvreur's on-the-fly SCC algorithm.
+  // Unlike the nested DFS, every state is expanded once and the search stops as soon as the partial SCC being explored contains an accepting state.
+  // Returns a lasso of the same shape as FindAcceptingRun, or std::nullopt if the Buchi's language is empty.
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRunSCC(Buchi<S,A,Fs...> const& buchi) {
+    auto marksOf = [&buchi](S const& s) {
+      return AcceptanceMarks(buchi.accepting(s) ? 1 : 0);
+    };
+    return _details_::CouvreurSearch<S>(buchi, marksOf, AcceptanceMarks(1));
+  }
+
+  // Searches a generalized Buchi automaton for an accepting run using Couvreur's on-the-fly SCC algorithm.
+  // The acceptance sets are handled directly: a partial SCC is accepting once the union of the marks of its states contains every acceptance set.
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRunSCC(GeneralizedBuchi<S,A,Fs...> const& gBuchi) {
+    auto marksOf = [&gBuchi](S const& s) {
+      return gBuchi.getMarks(s);
+    };
+    return _details_::CouvreurSearch<S>(gBuchi, marksOf, gBuchi.allMarks());
+  }
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef BUCHI_SEARCH_HH
+#define BUCHI_SEARCH_HH
+
+#include <optional>
+#include <string>
+
+#include "buchi.hh"
+#include "buchi_utils.hh"
+#include "buchi_scc.hh"
+#include "buchi_parallel.hh"
+#include "buchi_swarm.hh"
+#include "generalized_buchi.hh"
+#include "state_interner.hh"
+#include "state_storage.hh"
+#include "successor_cache.hh"
+
+namespace mc {
+  // The algorithms that can be used to search a Buchi automaton for an accepting run.
+  enum class SearchAlgorithm {
+    NestedDFS,
+    SCC,
+    Swarm
+  };
+
+  // Options controlling how FindAcceptingRun searches for an accepting run.
+  struct SearchOptions {
+    SearchAlgorithm algorithm = SearchAlgorithm::NestedDFS;
+    // Number of threads the nested DFS runs on. More than one thread runs CNDFS and 0 means one thread per hardware thread.
+    size_t threads = 1;
+    // Memory limit in bytes for the visited sets of each swarm worker. 0 means no limit.
+    size_t workerMemoryLimit = 0;
+    // How the sequential nested DFS and the swarm workers store visited states. CNDFS and the SCC algorithm always store states exactly.
+    StateStorageOptions storage;
+    // Number of states whose transitions are cached during the search. 0 disables the cache.
+    size_t successorCacheSize = 0;
+  };
+
+  inline std::optional<SearchAlgorithm> ParseSearchAlgorithm(std::string const& name) {
+    if (name == "ndfs") {
+      return SearchAlgorithm::NestedDFS;
+    } else if (name == "scc") {
+      return SearchAlgorithm::SCC;
+    } else if (name == "swarm") {
+      return SearchAlgorithm::Swarm;
+    }
+    return std::nullopt;
+  }
+
+  // Searches a Buchi automaton for an accepting run with the algorithm chosen in options.
+  // Every algorithm returns a lasso of the same shape, or std::nullopt if none was found.
+  // Not finding a lasso only proves the Buchi's language is empty if the search was complete, which is reported through statistics.
+  namespace _details_ {
+    // Wraps automaton in a successor cache and searches the result with search, recording the cache's hits and misses in statistics.
+    // search is passed options with the cache turned off so it does not wrap the automaton again.
+    // The cached automaton is type erased (see CacheSuccessors), so caching it again would not make yet another type.
+    template <typename B, typename F>
+    auto SearchCached(B const& automaton, SearchOptions options, SearchStatistics* statistics, F const& search) {
+      auto [cachedAutomaton, cache] = CacheSuccessors(automaton, options.successorCacheSize);
+      options.successorCacheSize = 0;
+      auto result = search(cachedAutomaton, options);
+      if (statistics) {
+        statistics->cacheHits = cache->hits();
+        statistics->cacheMisses = cache->misses();
+      }
+      return result;
+    }
+
+    // Drops the counters that Degeneralize pairs the states with.
+    template <typename S>
+    std::vector<S> StripCounters(std::vector<std::pair<S,size_t>> const& degenStates) {
+      std::vector<S> states;
+      states.reserve(degenStates.size());
+      for (auto const& [state, _] : degenStates) {
+        states.emplace_back(state);
+      }
+      return states;
+    }
+  }
+
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRun(Buchi<S,A,Fs...> const& buchi, SearchOptions const& options, SearchStatistics* statistics = nullptr) {
+    if (options.successorCacheSize != 0) {
+      return _details_::SearchCached(buchi, options, statistics, [statistics](auto const& cached, SearchOptions const& uncachedOptions) {
+        return FindAcceptingRun(cached, uncachedOptions, statistics);
+      });
+    }
+
+    switch (options.algorithm) {
+    case SearchAlgorithm::SCC:
+      return FindAcceptingRunSCC(buchi);
+
+    case SearchAlgorithm::Swarm:
+      return FindAcceptingRunSwarm(buchi, options.threads, options.workerMemoryLimit, options.storage, statistics);
+
+    case SearchAlgorithm::NestedDFS:
+    default:
+      if (options.threads != 1) {
+        return FindAcceptingRunParallel(buchi, options.threads);
+      }
+      SearchArena arena;
+      return _details_::WithStateSets<S>(options.storage, arena.resource(), [&](auto hashed, auto flagged) {
+        _details_::NestedDFS<Buchi<S,A,Fs...>, decltype(hashed)> search(buchi, std::move(hashed), std::move(flagged), arena.resource());
+        auto result = search.run();
+        if (statistics) {
+          statistics->storedStates = search.storedStates();
+          statistics->storageBytes = search.storedBytes();
+          statistics->omissionProbability = search.omissionProbability();
+        }
+        return result;
+      });
+    }
+  }
+
+  // Searches a generalized Buchi automaton for an accepting run with the algorithm chosen in options.
+  // The SCC algorithm handles the acceptance sets directly. The other algorithms only understand a single acceptance set,
+  // so they search the degeneralized automaton and the counters are stripped from the resulting lasso.
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRun(GeneralizedBuchi<S,A,Fs...> const& gBuchi, SearchOptions const& options, SearchStatistics* statistics = nullptr) {
+    // Caching the generalized automaton rather than the degeneralized one keeps a single entry per state, whatever its counter.
+    if (options.successorCacheSize != 0) {
+      return _details_::SearchCached(gBuchi, options, statistics, [statistics](auto const& cached, SearchOptions const& uncachedOptions) {
+        return FindAcceptingRun(cached, uncachedOptions, statistics);
+      });
+    }
+
+    if (options.algorithm == SearchAlgorithm::SCC) {
+      return FindAcceptingRunSCC(gBuchi);
+    }
+
+    if constexpr (std::is_integral_v<S>) {
+      if (options.storage.denseStates != 0) {
+        // The degeneralized states pair a dense state with a counter up to the number of acceptance sets,
+        // so they are numbered densely as well, letting the search keep them in bitmaps.
+        PairDomain degenDomain(IntegerDomain<S>(0, static_cast<S>(options.storage.denseStates)),
+                               IntegerDomain<size_t>(0, gBuchi.getNumAcceptanceSets() + 1));
+        auto [denseBuchi, degenStates] = NumberStates(Degeneralize(gBuchi), degenDomain);
+        SearchOptions denseOptions = options;
+        denseOptions.storage.denseStates = degenStates->size();
+        auto opt_indexLasso = FindAcceptingRun(denseBuchi, denseOptions, statistics);
+        if (!opt_indexLasso) {
+          return std::nullopt;
+        }
+        auto [stem, loop] = MaterializeLasso(*opt_indexLasso, *degenStates);
+        return std::make_optional(std::make_pair(_details_::StripCounters(stem), _details_::StripCounters(loop)));
+      }
+    }
+
+    auto opt_degenLasso = FindAcceptingRun(Degeneralize(gBuchi), options, statistics);
+    if (!opt_degenLasso) {
+      return std::nullopt;
+    }
+    return std::make_optional(std::make_pair(_details_::StripCounters(opt_degenLasso->first),
+                                             _details_::StripCounters(opt_degenLasso->second)));
+  }
+}
+
+#endif
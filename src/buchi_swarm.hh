@@ -0,0 +1,92 @@
+#ifndef BUCHI_SWARM_HH
+#define BUCHI_SWARM_HH
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "buchi.hh"
+#include "buchi_utils.hh"
+#include "search_arena.hh"
+#include "state_storage.hh"
+
+namespace mc {
+  // Swarm verification: numWorkers independent nested DFS searches run in parallel, each with its own random successor order
+  // and its own visited sets, and the first lasso found by any of them is returned. The workers share nothing but a stop flag.
+  // Each worker gives up once its visited sets would need more than workerMemoryLimit bytes (0 means no limit),
+  // so the swarm can hunt for counterexamples in automata too large to search completely.
+  // With bitstate storage each worker's bit arrays are sized to workerMemoryLimit (storage.bitstateBytes if there is no limit) instead,
+  // so workers never give up but may skip states.
+  // If every worker gives up without finding a lasso then the search is incomplete, which is reported through statistics
+  // along with the states stored and the largest omission probability over all workers.
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRunSwarm(Buchi<S,A,Fs...> const& buchi, size_t numWorkers, size_t workerMemoryLimit,
+                                                StateStorageOptions storage = {}, SearchStatistics* statistics = nullptr) {
+    if (numWorkers == 0) {
+      numWorkers = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    if (storage.mode == StateStorage::Bitstate && workerMemoryLimit != 0) {
+      storage.bitstateBytes = workerMemoryLimit;
+    }
+
+    std::atomic<bool> stop = false;
+    std::mutex resultMutex;
+    std::optional<Lasso<S>> result;
+    std::exception_ptr error;
+    SearchStatistics swarmStatistics;
+    swarmStatistics.complete = false;
+
+    std::vector<std::thread> workers;
+    for (size_t id = 0; id < numWorkers; ++id) {
+      workers.emplace_back([&, id]() {
+        try {
+          SearchArena arena;
+          _details_::WithStateSets<S>(storage, arena.resource(), [&](auto hashed, auto flagged) {
+            _details_::NestedDFS<Buchi<S,A,Fs...>, decltype(hashed)> search(buchi, std::move(hashed), std::move(flagged), arena.resource());
+            // Worker 0 keeps the natural successor order so a swarm of one behaves like FindAcceptingRun.
+            if (id != 0) {
+              search.randomize(id);
+            }
+            search.limitMemory(workerMemoryLimit);
+            search.stopWhen(stop);
+
+            auto lasso = search.run();
+            std::lock_guard<std::mutex> lock(resultMutex);
+            if (lasso && !result) {
+              result = std::move(lasso);
+            }
+            if (lasso || !search.aborted()) {
+              // Either a counterexample was found or this worker searched everything and proved there is none.
+              swarmStatistics.complete = true;
+              stop = true;
+            }
+            swarmStatistics.storedStates += search.storedStates();
+            swarmStatistics.storageBytes += search.storedBytes();
+            swarmStatistics.omissionProbability = std::max(swarmStatistics.omissionProbability, search.omissionProbability());
+          });
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(resultMutex);
+          error = std::current_exception();
+          stop = true;
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    if (statistics) {
+      *statistics = swarmStatistics;
+    }
+    return result;
+  }
+}
+
+#endif
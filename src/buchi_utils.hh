@@ -5,8 +5,17 @@
 #include <optional>
 #include <utility>
 #include <any>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+#include <random>
 
 #include "buchi.hh"
+#include "auto_set.hh"
+#include "auto_map.hh"
+#include "search_arena.hh"
+#include "state_storage.hh"
 
 namespace mc {
   // First component of Lasso is the sequence of elements up to, but not including the loop
@@ -14,79 +23,287 @@ namespace mc {
   template <typename S>
   using Lasso = std::pair<std::vector<S>, std::vector<S>>;
 
+  // Information about how a search for an accepting run went.
+  struct SearchStatistics {
+    // False if the search gave up before exploring every reachable state.
+    // Not finding a lasso in an incomplete search does not prove that the language is empty.
+    bool complete = true;
+    // Number of states stored in the visited sets and an estimate of the memory they use.
+    // Only the nested DFS based searches (sequential and swarm) fill these in.
+    size_t storedStates = 0;
+    size_t storageBytes = 0;
+    // Estimated probability that approximate state storage (bitstate or hash compaction) wrongly treated
+    // a new state as visited, in which case part of the automaton may not have been searched.
+    double omissionProbability = 0;
+    // Hits and misses of the successor cache, if one was used.
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+  };
+
   // Hiding implementation details under a namespace that is not meant to be accessed.
   namespace _details_ {
-    template <typename S, typename A>
-    std::optional<Lasso<S>> dfs2(Buchi<S,A> const& buchi, S const& q, std::vector<S> const& stack1, std::vector<S>& stack2, auto_set<S>& flagged) {
-      flagged.insert(q);
-      for (auto& [_,next] : buchi.getTransitions(q)) {
-        auto iter = stack1.begin();
-        for(; iter != stack1.end(); ++iter) {
-          if (*iter == next) {
-            std::vector<S> loop (iter, stack1.end());
-            loop.insert(loop.end(), stack2.begin()+1, stack2.end());
-            return std::make_optional(std::make_pair(std::vector<S>(stack1.begin(), iter), loop));
-          }
+    // A single frame of an explicit DFS stack: the state being expanded and the range of its successors in the stack's successor buffer.
+    // The successors from cursor to end have not been visited yet.
+    template <typename S>
+    struct DFSFrame {
+      S state;
+      size_t begin;
+      size_t cursor;
+      size_t end;
+    };
+
+    // An explicit DFS stack. Frames live on the heap (inside a std::vector) so the depth of the search is bounded by memory rather than by the native call stack.
+    // The successors of all frames share a single buffer, the top frame's at its end, and are filled with forEachTransition.
+    // Once the buffers have grown to the depth of the search, pushing and popping states allocates nothing.
+    template <typename S>
+    class DFSStack {
+    public:
+      explicit DFSStack(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : frames(resource),
+          successors(resource)
+        {}
+
+      template <typename B>
+      void push(B const& automaton, S const& state) {
+        size_t begin = successors.size();
+        automaton.forEachTransition(state, [this](auto const&, S const& next) {
+          successors.emplace_back(next);
+        });
+        frames.push_back(DFSFrame<S>{state, begin, begin, successors.size()});
+      }
+
+      void pop() {
+        successors.erase(successors.begin() + frames.back().begin, successors.end());
+        frames.pop_back();
+      }
+
+      // Puts the unvisited successors of the top frame in a random order.
+      template <typename R>
+      void shuffleTop(R& rng) {
+        std::shuffle(successors.begin() + frames.back().cursor, successors.begin() + frames.back().end, rng);
+      }
+
+      bool empty() const {
+        return frames.empty();
+      }
+
+      size_t size() const {
+        return frames.size();
+      }
+
+      // The state of the top frame.
+      S const& top() const {
+        return frames.back().state;
+      }
+
+      // The state of the frame at the given depth, 0 being the bottom of the stack.
+      S const& operator[](size_t depth) const {
+        return frames[depth].state;
+      }
+
+      // Whether every successor of the top frame has been visited.
+      bool done() const {
+        return frames.back().cursor == frames.back().end;
+      }
+
+      // Returns the next successor of the top frame to visit. Returned by value since pushing may move the buffer.
+      S nextSuccessor() {
+        return successors[frames.back().cursor++];
+      }
+
+    private:
+      std::pmr::vector<DFSFrame<S>> frames;
+      std::pmr::vector<S> successors;
+    };
+
+    // The nested DFS (double DFS) behind FindAcceptingRun.
+    // By default it is the classic complete search. It can also explore successors in a random order, give up once its visited sets
+    // use too much memory, or be stopped from another thread. A search that gave up or was stopped reports aborted().
+    // B is the type of the Buchi automaton searched and Storage the type of the visited sets, one of the state sets of state_storage.hh.
+    // The stacks of the search are allocated from resource, usually the search's SearchArena.
+    template <typename B, typename Storage = ExactStateSet<typename B::StateType>>
+    class NestedDFS {
+    public:
+      using S = typename B::StateType;
+
+      NestedDFS(B const& buchi, Storage hashed = Storage(), Storage flagged = Storage(),
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : buchi(buchi),
+          hashed(std::move(hashed)),
+          flagged(std::move(flagged)),
+          resource(resource),
+          maxBytes(0),
+          stop(nullptr),
+          wasAborted(false)
+        {}
+
+      void randomize(std::uint64_t seed) {
+        rng.emplace(seed);
+      }
+
+      // Gives up the search once the visited sets use more than maxBytes bytes. 0 means there is no limit.
+      void limitMemory(size_t newMaxBytes) {
+        maxBytes = newMaxBytes;
+      }
+
+      void stopWhen(std::atomic<bool> const& stopFlag) {
+        stop = &stopFlag;
+      }
+
+      bool aborted() const {
+        return wasAborted;
+      }
+
+      size_t storedStates() const {
+        return hashed.size() + flagged.size();
+      }
+
+      size_t storedBytes() const {
+        return hashed.bytes() + flagged.bytes();
+      }
+
+      double omissionProbability() const {
+        double p1 = hashed.omissionProbability();
+        double p2 = flagged.omissionProbability();
+        // Same as 1 - (1 - p1) * (1 - p2) without rounding tiny probabilities to 0.
+        return p1 + p2 - p1 * p2;
+      }
+
+      std::optional<Lasso<S>> run() {
+        std::vector<S> initStates(buchi.getInitialStates().begin(), buchi.getInitialStates().end());
+        if (rng) {
+          std::shuffle(initStates.begin(), initStates.end(), *rng);
         }
-        if (flagged.count(next) == 0) {
-          stack2.push_back(next);
-          auto result = dfs2(buchi, next, stack1, stack2, flagged);
-          if (result) {
+        for (auto& initState : initStates) {
+          if (hashed.contains(initState)) {
+            continue;
+          }
+          auto result = dfs1(initState);
+          if (result || wasAborted) {
             return result;
           }
-          stack2.pop_back();
         }
+        return std::nullopt;
       }
-      return std::nullopt;
-    }
-    
-    template <typename S, typename A>
-    std::optional<Lasso<S>> dfs1(Buchi<S,A> const& buchi, S const& q, std::vector<S>& stack, auto_set<S>& hashed, auto_set<S>& flagged) {
-      hashed.insert(q);
-      for (auto& [_,next] : buchi.getTransitions(q)) {
-        if (hashed.count(next) == 0) {
-          stack.push_back(next);
-          auto result = dfs1(buchi, next, stack, hashed, flagged);
-          if (result) {
-            return result;
+
+    private:
+      void push(DFSStack<S>& frames, S const& state) {
+        frames.push(buchi, state);
+        if (rng) {
+          frames.shuffleTop(*rng);
+        }
+      }
+
+      bool shouldAbort() {
+        wasAborted = wasAborted
+          || (maxBytes != 0 && storedBytes() > maxBytes)
+          || (stop != nullptr && *stop);
+        return wasAborted;
+      }
+
+      // First (blue) DFS of the nested DFS. Once all successors of an accepting state have been explored, the second DFS is started from it.
+      std::optional<Lasso<S>> dfs1(S const& init) {
+        DFSStack<S> frames(resource);
+        std::pmr::vector<S> stack(resource);
+        pmr::auto_map<S,size_t> stackIndex(resource);
+
+        auto pushBlue = [&](S const& q) {
+          hashed.insert(q);
+          stackIndex.emplace(q, stack.size());
+          stack.emplace_back(q);
+          push(frames, q);
+        };
+        pushBlue(init);
+
+        while (!frames.empty()) {
+          if (shouldAbort()) {
+            return std::nullopt;
           }
+          if (!frames.done()) {
+            S next = frames.nextSuccessor();
+            if (!hashed.contains(next)) {
+              pushBlue(next);
+            }
+            continue;
+          }
+
+          S const& state = frames.top();
+          if (buchi.accepting(state)) {
+            auto result = dfs2(state, stack, stackIndex);
+            if (result || wasAborted) {
+              return result;
+            }
+          }
+          stackIndex.erase(state);
           stack.pop_back();
+          frames.pop();
         }
+        return std::nullopt;
       }
-      if (buchi.accepting(q)) {
-        std::vector<S> stack2{};
-        stack2.emplace_back(q);
-        return dfs2(buchi, q, stack, stack2, flagged);
+
+      // Second (red) DFS of the nested DFS. Searches for a path from the accepting state q back to a state on the first DFS stack.
+      // stack1Index maps each state on stack1 to its position so that closing a cycle is a single lookup rather than a scan of stack1.
+      std::optional<Lasso<S>> dfs2(S const& q, std::pmr::vector<S> const& stack1, pmr::auto_map<S,size_t> const& stack1Index) {
+        DFSStack<S> frames(resource);
+        flagged.insert(q);
+        push(frames, q);
+
+        while (!frames.empty()) {
+          if (shouldAbort()) {
+            return std::nullopt;
+          }
+          if (frames.done()) {
+            frames.pop();
+            continue;
+          }
+
+          S next = frames.nextSuccessor();
+          auto indexIter = stack1Index.find(next);
+          if (indexIter != stack1Index.end()) {
+            auto cycleStart = stack1.begin() + indexIter->second;
+            std::vector<S> loop (cycleStart, stack1.end());
+            for (size_t depth = 1; depth < frames.size(); ++depth) {
+              loop.emplace_back(frames[depth]);
+            }
+            return std::make_optional(std::make_pair(std::vector<S>(stack1.begin(), cycleStart), loop));
+          }
+          if (flagged.insert(next)) {
+            push(frames, next);
+          }
+        }
+        return std::nullopt;
       }
-      return std::nullopt;
-    }
+
+      B const& buchi;
+      Storage hashed;
+      Storage flagged;
+      std::pmr::memory_resource* resource;
+      std::optional<std::mt19937_64> rng;
+      size_t maxBytes;
+      std::atomic<bool> const* stop;
+      bool wasAborted;
+    };
   }
 
   // Searches a Buchi automaton for an accepting run. Returns a lasso if one is found.
   // Otherwise returns std::nullopt_t which implies the Buchi's language is empty.
-  template <typename S, typename A>
-  std::optional<Lasso<S>> FindAcceptingRun(Buchi<S,A> const& buchi) {
-    auto_set<S> hashed;
-    auto_set<S> flagged;
-    for (auto& initState : buchi.getInitialStates()) {
-      std::vector<S> stack {};
-      stack.emplace_back(initState);
-      auto result = _details_::dfs1(buchi, initState, stack, hashed, flagged);
-      if (result) {
-        return result;
-      }
-    }
-    return std::nullopt;
+  // The search is a non-recursive nested DFS, so its depth is only limited by the available memory.
+  template <typename S, typename A, typename... Fs>
+  std::optional<Lasso<S>> FindAcceptingRun(Buchi<S,A,Fs...> const& buchi) {
+    SearchArena arena;
+    ExactStateSet<S> hashed(arena.resource());
+    ExactStateSet<S> flagged(arena.resource());
+    return _details_::NestedDFS<Buchi<S,A,Fs...>>(buchi, std::move(hashed), std::move(flagged), arena.resource()).run();
   }
 
   // Calculates the intersection of two buchi automata. M must be a functor with bool operator()(A1 const&, A2 const&) that determines if an element of A1 and an element of A2 are a "match".
-  template <typename S1, typename S2, typename A1, typename A2, typename M>
-  auto Intersection(Buchi<S1,A1> const& b1, Buchi<S2,A2> const& b2, M const& labelMatch) {
+  // The intersection keeps the types of the functions of b1, b2 and labelMatch, so expanding a product state calls them directly.
+  template <typename S1, typename S2, typename A1, typename A2, typename... Fs1, typename... Fs2, typename M>
+  auto Intersection(Buchi<S1,A1,Fs1...> const& b1, Buchi<S2,A2,Fs2...> const& b2, M const& labelMatch) {
     using InterStateType = std::tuple<S1, S2, int>;
-    using BuchiType = Buchi<InterStateType, A1>;
 
     // Initial state construction
-    typename BuchiType::StateSet interInitialStates;
+    auto_set<InterStateType> interInitialStates;
     for (auto const& s1 : b1.getInitialStates()) {
       for (auto const& s2 : b2.getInitialStates()) {
         interInitialStates.emplace(s1, s2, 0);
@@ -99,15 +316,12 @@ namespace mc {
     };
 
     // Definition of state transition function
-    auto interStateTransitions = [b1,b2,labelMatch](InterStateType const& s) {
-      typename BuchiType::TransitionSet transitions;
+    // The transitions of b2 are enumerated again for every transition of b1, so b2 should be the automaton whose transitions are cheaper to visit.
+    auto interStateTransitions = [b1,b2,labelMatch](InterStateType const& s, auto const& visit) {
       int x = std::get<2>(s);
 
-      auto const& b1Trans = b1.getTransitions(std::get<0>(s));
-      auto const& b2Trans = b2.getTransitions(std::get<1>(s));
-
-      for (auto const& [label1, head1] : b1Trans) {
-        for (auto const& [label2, head2] : b2Trans) {
+      b1.forEachTransition(std::get<0>(s), [&](A1 const& label1, S1 const& head1) {
+        b2.forEachTransition(std::get<1>(s), [&](A2 const& label2, S2 const& head2) {
           if (labelMatch(label1,label2)) {
             int y = x;
             if (x == 0 && b1.accepting(head1)) {
@@ -117,18 +331,17 @@ namespace mc {
             } else if (x == 2) {
               y = 0;
             }
-            transitions.emplace(label1, std::make_tuple(head1, head2, y));
+            visit(label1, std::make_tuple(head1, head2, y));
           }
-        }
-      }
-      return transitions;
+        });
+      });
     };
 
-    return BuchiType(interInitialStates, interStateTransitions, interAcceptingStates);
+    return MakeBuchi<InterStateType, A1>(interInitialStates, interStateTransitions, interAcceptingStates);
   }
 
-  template <typename S1, typename S2, typename A>
-  auto Intersection(Buchi<S1,A> const& b1, Buchi<S2,A> const& b2) {
+  template <typename S1, typename S2, typename A, typename... Fs1, typename... Fs2>
+  auto Intersection(Buchi<S1,A,Fs1...> const& b1, Buchi<S2,A,Fs2...> const& b2) {
     return Intersection(b1, b2,std::equal_to<A>{});
   }
 }
@@ -0,0 +1,415 @@
+#ifndef CONCURRENT_SET_HH
+#define CONCURRENT_SET_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "auto_map.hh"
+#include "auto_traits.hh"
+#include "hash.hh"
+
+namespace mc {
+  // Bit flags attached to the elements of a concurrent set, e.g. to color states in a parallel search.
+  using Colors = std::uint8_t;
+
+  /**
+   * A set of hashable values that any number of threads can insert into and search at the same time, without a lock.
+   * Elements cannot be erased, which is all a shared visited set needs and what keeps the set simple to get right.
+   *
+   * Every slot has a 64 bit tag holding the element's colors, the slot's state, and the high bits of the element's hash.
+   * A thread claims an empty slot by compare and swapping its tag to busy, constructs the element, and then publishes it by
+   * marking the tag full. Threads that meet a busy slot with their hash bits wait for it to be published before comparing.
+   * Slots are probed linearly within a window of ProbeWindow slots, so an element is always within the window of its hash.
+   *
+   * Once a table is MaxLoad full, or a window has no empty slot left, the table is replaced by one GrowthFactor times larger.
+   * The threads inserting into the old table move its elements over chunk by chunk, marking every slot as moved,
+   * and threads that meet a moved slot carry on in the new table. Old tables are kept until the set is destroyed, as other threads may still be reading them,
+   * which adds at most a third to the memory of the set.
+   */
+  template <typename T, typename THash = Hash<T>, typename TEqual = std::equal_to<T>>
+  class concurrent_hash_set {
+  public:
+    explicit concurrent_hash_set(size_t initialCapacity = DefaultCapacity)
+      : first(std::make_unique<Table>(RoundUpToPowerOfTwo(initialCapacity))),
+        current(first.get())
+      {}
+    concurrent_hash_set(concurrent_hash_set const&) = delete;
+    concurrent_hash_set& operator=(concurrent_hash_set const&) = delete;
+
+    ~concurrent_hash_set() {
+      // Destroyed iteratively so that a long chain of tables cannot overflow the stack.
+      std::unique_ptr<Table> table = std::move(first);
+      while (table) {
+        std::unique_ptr<Table> next(table->next.load(std::memory_order_relaxed));
+        table = std::move(next);
+      }
+    }
+
+    // Inserts value unless it is already in the set. Returns true if it was inserted.
+    bool insert(T const& value) {
+      return locate(current.load(std::memory_order_acquire), value, HashOf(value), true, 0).inserted;
+    }
+
+    bool contains(T const& value) const {
+      // An element that has been moved on is still in the set, so there is no need to follow it.
+      return locate(current.load(std::memory_order_acquire), value, HashOf(value), false, 0).tag != nullptr;
+    }
+
+    // Adds colors to value, inserting it first if it is not in the set yet. Returns the colors value had before, 0 if it was inserted.
+    Colors paint(T const& value, Colors colors) {
+      return paint(current.load(std::memory_order_acquire), value, HashOf(value), colors);
+    }
+
+    // The colors of value, 0 if it is not in the set.
+    Colors colorsOf(T const& value) const {
+      std::uint64_t hash = HashOf(value);
+      Colors colors = 0;
+      Table* table = current.load(std::memory_order_acquire);
+      while (true) {
+        Slot slot = locate(table, value, hash, false, 0);
+        if (slot.tag == nullptr) {
+          // Either value is not in the set, or it is still being moved into the next table and only has the colors read so far.
+          return colors;
+        }
+        std::uint64_t tag = slot.tag->load(std::memory_order_acquire);
+        colors |= tag & ColorBits;
+        if ((tag & MovedBit) == 0) {
+          return colors;
+        }
+        table = slot.table->next.load(std::memory_order_acquire);
+      }
+    }
+
+    // Counts the elements by scanning every table, so it is slow, and only exact once no thread is inserting anymore.
+    size_t size() const {
+      size_t count = 0;
+      for (Table const* table = first.get(); table != nullptr; table = table->next.load(std::memory_order_acquire)) {
+        for (size_t i = 0; i < table->capacity; ++i) {
+          if ((table->tags[i].load(std::memory_order_relaxed) & (FullBit | MovedBit)) == FullBit) {
+            ++count;
+          }
+        }
+      }
+      return count;
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+  private:
+    static constexpr size_t DefaultCapacity = size_t(1) << 12;
+    static constexpr size_t GrowthFactor = 4;
+    // Tables are replaced long before a window fills up, unless the hash function is poor.
+    static constexpr size_t ProbeWindow = 128;
+    // The number of slots a thread moves to the next table at a time.
+    static constexpr size_t ChunkSize = 1024;
+    // A table is replaced once it is MaxLoad full.
+    static constexpr double MaxLoad = 0.6;
+    // Only the elements whose hash has these bits clear are counted, so that threads rarely touch the shared count.
+    static constexpr size_t SampleMask = 63;
+
+    static constexpr std::uint64_t EmptyTag = 0;
+    static constexpr std::uint64_t ColorBits = 0xff;
+    static constexpr std::uint64_t BusyBit = std::uint64_t(1) << 8;
+    static constexpr std::uint64_t FullBit = std::uint64_t(1) << 9;
+    // An empty slot marked as moved can no longer be taken.
+    static constexpr std::uint64_t MovedBit = std::uint64_t(1) << 10;
+    static constexpr int HashShift = 11;
+    static constexpr std::uint64_t HashBits = ~((std::uint64_t(1) << HashShift) - 1);
+
+    // Only the hash bits kept in the tags are used, so that moving an element does not need to hash it again.
+    static std::uint64_t HashOf(T const& value) {
+      return MixHash(THash{}(value)) & HashBits;
+    }
+
+    static size_t RoundUpToPowerOfTwo(size_t n) {
+      size_t power = ProbeWindow;
+      while (power < n) {
+        power *= 2;
+      }
+      return power;
+    }
+
+    struct Table {
+      explicit Table(size_t capacity)
+        : capacity(capacity),
+          chunkSize(std::min(ChunkSize, capacity)),
+          maxSampledSize(static_cast<size_t>(capacity * MaxLoad) / (SampleMask + 1) + 1),
+          tags(new std::atomic<std::uint64_t>[capacity]()),
+          slots(std::allocator<T>().allocate(capacity))
+        {}
+      Table(Table const&) = delete;
+      Table& operator=(Table const&) = delete;
+
+      ~Table() {
+        for (size_t i = 0; i < capacity; ++i) {
+          if ((tags[i].load(std::memory_order_relaxed) & FullBit) != 0) {
+            slots[i].~T();
+          }
+        }
+        std::allocator<T>().deallocate(slots, capacity);
+      }
+
+      size_t numChunks() const {
+        return capacity / chunkSize;
+      }
+
+      size_t capacity;
+      size_t chunkSize;
+      size_t maxSampledSize;
+      std::unique_ptr<std::atomic<std::uint64_t>[]> tags;
+      T* slots;
+      // The table replacing this one, once it is full.
+      std::atomic<Table*> next = nullptr;
+      // The number of sampled elements in the table, which estimates the number of elements times SampleMask + 1.
+      std::atomic<size_t> sampledSize = 0;
+      std::atomic<size_t> claimedChunks = 0;
+      std::atomic<size_t> movedChunks = 0;
+    };
+
+    struct Slot {
+      std::atomic<std::uint64_t>* tag;
+      Table* table;
+      bool inserted;
+    };
+
+    // Finds value's slot, starting from table. If value is not in the set, it is inserted with the given colors if insert is true,
+    // and otherwise the returned tag is nullptr. The slot found may have been moved on to the next table.
+    Slot locate(Table* table, T const& value, std::uint64_t hash, bool insert, Colors colors) const {
+      while (true) {
+        if (insert && table->next.load(std::memory_order_acquire) != nullptr) {
+          // The table is being replaced, so moving its elements comes first.
+          moveElements(table);
+        }
+        size_t mask = table->capacity - 1;
+        size_t start = static_cast<size_t>(hash >> HashShift);
+        bool movedOn = false;
+        for (size_t i = 0; i < ProbeWindow; ++i) {
+          size_t index = (start + i) & mask;
+          std::atomic<std::uint64_t>& tag = table->tags[index];
+          std::uint64_t current = tag.load(std::memory_order_acquire);
+          if (current == EmptyTag) {
+            if (!insert) {
+              return Slot{nullptr, table, false};
+            }
+            if (tag.compare_exchange_strong(current, BusyBit | hash, std::memory_order_acquire)) {
+              new (&table->slots[index]) T(value);
+              tag.store(FullBit | hash | colors, std::memory_order_release);
+              if ((start & SampleMask) == 0 && table->sampledSize.fetch_add(1, std::memory_order_relaxed) + 1 == table->maxSampledSize) {
+                grow(table);
+                moveElements(table);
+              }
+              return Slot{&tag, table, true};
+            }
+            // Another thread took the slot first, and current now holds its tag.
+          }
+          if (current == MovedBit) {
+            movedOn = true;
+            break;
+          }
+          if ((current & HashBits) != hash) {
+            continue;
+          }
+          while ((current & BusyBit) != 0) {
+            std::this_thread::yield();
+            current = tag.load(std::memory_order_acquire);
+          }
+          if (TEqual{}(table->slots[index], value)) {
+            return Slot{&tag, table, false};
+          }
+        }
+
+        // Value is not in this table, and if it is in the set at all, it is in one of the tables replacing it.
+        if (insert) {
+          Table* next = movedOn ? table->next.load(std::memory_order_acquire) : grow(table);
+          moveElements(table);
+          table = next;
+        } else {
+          table = table->next.load(std::memory_order_acquire);
+          if (table == nullptr) {
+            return Slot{nullptr, nullptr, false};
+          }
+        }
+      }
+    }
+
+    Colors paint(Table* table, T const& value, std::uint64_t hash, Colors colors) const {
+      Colors before = 0;
+      while (true) {
+        Slot slot = locate(table, value, hash, true, colors);
+        if (slot.inserted) {
+          return before;
+        }
+        std::uint64_t tag = slot.tag->load(std::memory_order_acquire);
+        while ((tag & MovedBit) == 0 &&
+               !slot.tag->compare_exchange_weak(tag, tag | colors, std::memory_order_acq_rel, std::memory_order_acquire)) {}
+        before |= tag & ColorBits;
+        if ((tag & MovedBit) == 0) {
+          return before;
+        }
+        // The element has been moved on, and its colors are kept in the next table from now on.
+        table = slot.table->next.load(std::memory_order_acquire);
+      }
+    }
+
+    // Returns the table replacing table, adding it if there is none yet.
+    Table* grow(Table* table) const {
+      Table* next = table->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        auto added = std::make_unique<Table>(table->capacity * GrowthFactor);
+        if (table->next.compare_exchange_strong(next, added.get(), std::memory_order_acq_rel)) {
+          next = added.release();
+        }
+      }
+      return next;
+    }
+
+    // Helps moving the elements of table to the next table, until every chunk has been taken by some thread.
+    void moveElements(Table* table) const {
+      if (table->claimedChunks.load(std::memory_order_relaxed) >= table->numChunks()) {
+        return;
+      }
+      Table* next = table->next.load(std::memory_order_acquire);
+      size_t chunk;
+      while ((chunk = table->claimedChunks.fetch_add(1, std::memory_order_relaxed)) < table->numChunks()) {
+        size_t end = (chunk + 1) * table->chunkSize;
+        for (size_t index = chunk * table->chunkSize; index < end; ++index) {
+          std::atomic<std::uint64_t>& tag = table->tags[index];
+          std::uint64_t current = tag.load(std::memory_order_acquire);
+          while (true) {
+            if ((current & BusyBit) != 0) {
+              std::this_thread::yield();
+              current = tag.load(std::memory_order_acquire);
+            } else if (tag.compare_exchange_weak(current, current | MovedBit, std::memory_order_acq_rel, std::memory_order_acquire)) {
+              break;
+            }
+          }
+          if (current != EmptyTag) {
+            paint(next, table->slots[index], current & HashBits, static_cast<Colors>(current & ColorBits));
+          }
+        }
+        if (table->movedChunks.fetch_add(1, std::memory_order_acq_rel) + 1 == table->numChunks()) {
+          advance();
+        }
+      }
+    }
+
+    // Lets operations start from the first table whose elements have not all been moved on.
+    void advance() const {
+      Table* table = current.load(std::memory_order_acquire);
+      while (table->movedChunks.load(std::memory_order_acquire) == table->numChunks()) {
+        Table* next = table->next.load(std::memory_order_acquire);
+        if (current.compare_exchange_strong(table, next, std::memory_order_acq_rel)) {
+          table = next;
+        }
+      }
+    }
+
+    // Owns the chain of tables.
+    std::unique_ptr<Table> first;
+    mutable std::atomic<Table*> current;
+  };
+
+  namespace _details_ {
+    // A concurrent set for values that cannot be hashed, which leaves nothing to split the set on, so a single lock guards it.
+    template <typename T>
+    class LockedSet {
+    public:
+      bool insert(T const& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return elements.emplace(value, Colors(0)).second;
+      }
+
+      bool contains(T const& value) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return elements.count(value) == 1;
+      }
+
+      Colors paint(T const& value, Colors colors) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Colors& elementColors = elements[value];
+        Colors before = elementColors;
+        elementColors |= colors;
+        return before;
+      }
+
+      Colors colorsOf(T const& value) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto match = elements.find(value);
+        return match == elements.end() ? 0 : match->second;
+      }
+
+      size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return elements.size();
+      }
+
+      bool empty() const {
+        return size() == 0;
+      }
+
+    private:
+      mutable std::mutex mutex;
+      auto_map<T, Colors> elements;
+    };
+  }
+
+  /**
+   * A class representing a set that many threads can use at once, e.g. the visited states shared by the workers of a parallel search.
+   * Values can be inserted if absent and looked up, and each carries a few color bits that threads can add atomically.
+   * The underlying representation is chosen at compile time like that of auto_set:
+   * concurrent_hash_set, which needs no locks, if T is hashable with mc::Hash (see hash.hh),
+   * else a set behind a single lock.
+   */
+  template <typename T>
+  class concurrent_set {
+  public:
+    using set_representation =
+      std::conditional_t<traits::hashable<T>::value, concurrent_hash_set<T>, _details_::LockedSet<T>>;
+
+    concurrent_set() = default;
+    concurrent_set(concurrent_set const&) = delete;
+    concurrent_set& operator=(concurrent_set const&) = delete;
+
+    // Inserts value unless it is already in the set. Returns true if it was inserted.
+    bool insert(T const& value) {
+      return set.insert(value);
+    }
+
+    bool contains(T const& value) const {
+      return set.contains(value);
+    }
+
+    // Adds colors to value, inserting it first if it is not in the set yet. Returns the colors value had before, 0 if it was inserted.
+    Colors paint(T const& value, Colors colors) {
+      return set.paint(value, colors);
+    }
+
+    // The colors of value, 0 if it is not in the set.
+    Colors colorsOf(T const& value) const {
+      return set.colorsOf(value);
+    }
+
+    // Not exact while other threads are inserting.
+    size_t size() const {
+      return set.size();
+    }
+    bool empty() const {
+      return set.empty();
+    }
+
+  private:
+    set_representation set;
+  };
+}
+
+#endif
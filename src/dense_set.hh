@@ -0,0 +1,216 @@
+#ifndef DENSE_SET_HH
+#define DENSE_SET_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mc {
+  // A dense domain numbers every value of a bounded set of values 0, 1, ..., size()-1. Each domain provides:
+  //   size() is the number of values in the domain,
+  //   index(value) is the number of the value, and throws std::out_of_range if the value is not in the domain,
+  //   value(index) is the value with the given number.
+
+  // The integers in [lowest, end).
+  template <typename T>
+  class IntegerDomain {
+  public:
+    using ValueType = T;
+
+    IntegerDomain(T lowest, T end)
+      : lowest(lowest),
+        end(end < lowest ? lowest : end)
+      {}
+
+    size_t size() const {
+      return static_cast<size_t>(end - lowest);
+    }
+
+    size_t index(T value) const {
+      if (value < lowest || !(value < end)) {
+        throw std::out_of_range("Value is outside of its dense domain.");
+      }
+      return static_cast<size_t>(value - lowest);
+    }
+
+    T value(size_t index) const {
+      return static_cast<T>(lowest + static_cast<T>(index));
+    }
+
+  private:
+    T lowest;
+    T end;
+  };
+
+  // The values of Domain plus std::nullopt, which is numbered 0.
+  template <typename Domain>
+  class OptionalDomain {
+  public:
+    using ValueType = std::optional<typename Domain::ValueType>;
+
+    OptionalDomain(Domain domain) : domain(std::move(domain)) {}
+
+    size_t size() const {
+      return domain.size() + 1;
+    }
+
+    size_t index(ValueType const& value) const {
+      return value ? domain.index(*value) + 1 : 0;
+    }
+
+    ValueType value(size_t index) const {
+      return (index == 0) ? ValueType() : ValueType(domain.value(index - 1));
+    }
+
+  private:
+    Domain domain;
+  };
+
+  // The pairs of a value of Domain1 and a value of Domain2, numbered with the second value varying fastest.
+  template <typename Domain1, typename Domain2>
+  class PairDomain {
+  public:
+    using ValueType = std::pair<typename Domain1::ValueType, typename Domain2::ValueType>;
+
+    PairDomain(Domain1 first, Domain2 second) : first(std::move(first)), second(std::move(second)) {
+      if (this->second.size() != 0 && this->first.size() > SIZE_MAX / this->second.size()) {
+        throw std::length_error("Pair domain is too large to be numbered.");
+      }
+    }
+
+    size_t size() const {
+      return first.size() * second.size();
+    }
+
+    size_t index(ValueType const& value) const {
+      return first.index(value.first) * second.size() + second.index(value.second);
+    }
+
+    ValueType value(size_t index) const {
+      return ValueType(first.value(index / second.size()), second.value(index % second.size()));
+    }
+
+  private:
+    Domain1 first;
+    Domain2 second;
+  };
+
+  /**
+   * A class representing a set of values from a dense domain (see above) as a bitmap with one bit per value of the domain.
+   * The bitmap is split into pages that are only allocated once a value on them is inserted, so a set of a few values
+   * from a huge domain stays small, while a set covering most of a domain of n values takes about n/8 bytes.
+   */
+  template <typename T, typename Domain = IntegerDomain<T>>
+  class dense_set {
+  public:
+    dense_set(Domain domain)
+      : domain(std::move(domain)),
+        pages((this->domain.size() + PageBits - 1) / PageBits),
+        numValues(0),
+        numPages(0)
+      {}
+
+    dense_set(dense_set const& other)
+      : domain(other.domain),
+        pages(other.pages.size()),
+        numValues(other.numValues),
+        numPages(other.numPages)
+      {
+        for (size_t i = 0; i < pages.size(); ++i) {
+          if (other.pages[i]) {
+            pages[i] = std::make_unique<std::uint64_t[]>(PageWords);
+            std::copy(other.pages[i].get(), other.pages[i].get() + PageWords, pages[i].get());
+          }
+        }
+      }
+    dense_set(dense_set&&) = default;
+
+    dense_set& operator=(dense_set const& other) {
+      if (this != &other) {
+        *this = dense_set(other);
+      }
+      return *this;
+    }
+    dense_set& operator=(dense_set&&) = default;
+
+    // Returns true if value was not in the set before.
+    bool insert(T const& value) {
+      size_t index = domain.index(value);
+      auto& page = pages[index / PageBits];
+      if (!page) {
+        page = std::make_unique<std::uint64_t[]>(PageWords);
+        ++numPages;
+      }
+      std::uint64_t& word = page[(index % PageBits) / 64];
+      std::uint64_t mask = std::uint64_t(1) << (index % 64);
+      if ((word & mask) != 0) {
+        return false;
+      }
+      word |= mask;
+      ++numValues;
+      return true;
+    }
+
+    size_t erase(T const& value) {
+      size_t index = domain.index(value);
+      auto& page = pages[index / PageBits];
+      if (!page) {
+        return 0;
+      }
+      std::uint64_t& word = page[(index % PageBits) / 64];
+      std::uint64_t mask = std::uint64_t(1) << (index % 64);
+      if ((word & mask) == 0) {
+        return 0;
+      }
+      word &= ~mask;
+      --numValues;
+      return 1;
+    }
+
+    bool contains(T const& value) const {
+      size_t index = domain.index(value);
+      auto const& page = pages[index / PageBits];
+      return page && (page[(index % PageBits) / 64] >> (index % 64) & 1) != 0;
+    }
+
+    size_t count(T const& value) const {
+      return contains(value) ? 1 : 0;
+    }
+
+    void clear() {
+      for (auto& page : pages) {
+        page.reset();
+      }
+      numValues = 0;
+      numPages = 0;
+    }
+
+    size_t size() const {
+      return numValues;
+    }
+    bool empty() const {
+      return numValues == 0;
+    }
+
+    // Memory used by the allocated pages and the table of pages.
+    size_t bytes() const {
+      return numPages * PageWords * sizeof(std::uint64_t) + pages.size() * sizeof(pages[0]);
+    }
+
+  private:
+    // 8 KiB pages.
+    static constexpr size_t PageWords = 1024;
+    static constexpr size_t PageBits = PageWords * 64;
+
+    Domain domain;
+    std::vector<std::unique_ptr<std::uint64_t[]>> pages;
+    size_t numValues;
+    size_t numPages;
+  };
+}
+
+#endif
@@ -37,6 +37,11 @@ namespace mc {
       return !(*this == rhs);
     }
 
+    // Consistent with operator==, so only the id is hashed.
+    size_t hash() const {
+      return std::hash<int>{}(id);
+    }
+
     R operator()(Args... args) {
       return f(args...);
     }
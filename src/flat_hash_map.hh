@@ -0,0 +1,174 @@
+#ifndef FLAT_HASH_MAP_HH
+#define FLAT_HASH_MAP_HH
+
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "flat_hash_table.hh"
+#include "hash.hh"
+
+namespace mc {
+  namespace _details_ {
+    struct PairFirstKey {
+      template <typename Pair>
+      typename Pair::first_type const& operator()(Pair const& kv) const {
+        return kv.first;
+      }
+    };
+  }
+
+  /**
+   * A class representing a (unordered) map from hashable keys, with the key value pairs stored inline in a flat open addressing
+   * table (see flat_hash_table.hh). Lookups touch one array of control bytes and then the matching pairs, instead of chasing nodes.
+   * Inserting can move the pairs, so unlike std::unordered_map it does not keep references to them valid.
+   */
+  template <typename K, typename V, typename KHash = Hash<K>, typename KEqual = std::equal_to<K>,
+            typename Allocator = std::allocator<std::pair<const K, V>>>
+  class flat_hash_map {
+  public:
+    using value_type = std::pair<const K, V>;
+    using allocator_type = Allocator;
+
+  private:
+    using underlying_representation = _details_::FlatHashTable<value_type, K, _details_::PairFirstKey, KHash, KEqual, Allocator>;
+
+  public:
+    using iterator = typename underlying_representation::iterator;
+    using const_iterator = typename underlying_representation::const_iterator;
+
+    flat_hash_map() = default;
+    flat_hash_map(flat_hash_map const&) = default;
+    flat_hash_map(flat_hash_map&&) = default;
+    explicit flat_hash_map(Allocator const& allocator) : map(allocator) {}
+    template <typename InputIt>
+    flat_hash_map(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : map(allocator) {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+    }
+    flat_hash_map(std::initializer_list<std::pair<K,V>> init) : flat_hash_map(init.begin(), init.end()) {}
+    ~flat_hash_map() = default;
+
+    flat_hash_map& operator=(flat_hash_map const&) = default;
+    flat_hash_map& operator=(flat_hash_map&&) = default;
+    flat_hash_map& operator=(std::initializer_list<std::pair<K,V>> init) {
+      return *this = flat_hash_map(init);
+    }
+
+    bool operator==(flat_hash_map const& rhs) const {
+      if (size() != rhs.size()) {
+        return false;
+      }
+      for (auto const& [key, value] : map) {
+        auto match = rhs.find(key);
+        if (match == rhs.end() || !(match->second == value)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    bool operator!=(flat_hash_map const& rhs) const {
+      return !(*this == rhs);
+    }
+
+    allocator_type get_allocator() const {
+      return map.get_allocator();
+    }
+
+    iterator begin() {
+      return map.begin();
+    }
+    const_iterator begin() const {
+      return map.begin();
+    }
+    const_iterator cbegin() const {
+      return map.begin();
+    }
+
+    iterator end() {
+      return map.end();
+    }
+    const_iterator end() const {
+      return map.end();
+    }
+    const_iterator cend() const {
+      return map.end();
+    }
+
+    iterator find(const K& key) {
+      return map.find(key);
+    }
+    const_iterator find(const K& key) const {
+      return map.find(key);
+    }
+
+    std::pair<iterator,bool> insert(const value_type& kv) {
+      return map.findOrConstruct(kv.first, [&kv](void* slot) { new (slot) value_type(kv); });
+    }
+    std::pair<iterator,bool> insert(value_type&& kv) {
+      return map.findOrConstruct(kv.first, [&kv](void* slot) { new (slot) value_type(std::move(kv)); });
+    }
+
+    template <typename... Args>
+    std::pair<iterator,bool> emplace(Args&&... args) {
+      std::pair<K,V> kv (std::forward<Args>(args)...);
+      return map.findOrConstruct(kv.first, [&kv](void* slot) {
+        new (slot) value_type(std::move(kv.first), std::move(kv.second));
+      });
+    }
+
+    iterator erase(const_iterator pos) {
+      return map.erase(pos);
+    }
+    size_t erase(const K& key) {
+      return map.erase(key);
+    }
+
+    void clear() {
+      map.clear();
+    }
+
+    V& at(const K& key) {
+      return const_cast<V&>(static_cast<const flat_hash_map*>(this)->at(key));
+    }
+    const V& at(const K& key) const {
+      const_iterator match = find(key);
+      if (match == end()) {
+        throw std::out_of_range("Attempt to access value at a key that does not exist");
+      }
+      return match->second;
+    }
+
+    V& operator[](const K& key) {
+      return map.findOrConstruct(key, [&key](void* slot) {
+        new (slot) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+      }).first->second;
+    }
+    V& operator[](K&& key) {
+      return map.findOrConstruct(key, [&key](void* slot) {
+        new (slot) value_type(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple());
+      }).first->second;
+    }
+
+    size_t count(const K& key) const {
+      return find(key) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+      return map.size();
+    }
+    bool empty() const {
+      return map.empty();
+    }
+
+  private:
+    underlying_representation map;
+  };
+}
+
+#endif
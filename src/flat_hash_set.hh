@@ -0,0 +1,143 @@
+#ifndef FLAT_HASH_SET_HH
+#define FLAT_HASH_SET_HH
+
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "flat_hash_table.hh"
+#include "hash.hh"
+
+namespace mc {
+  namespace _details_ {
+    struct IdentityKey {
+      template <typename T>
+      T const& operator()(T const& value) const {
+        return value;
+      }
+    };
+  }
+
+  /**
+   * A class representing a (unordered) set of hashable values, stored inline in a flat open addressing table (see flat_hash_table.hh).
+   * Lookups touch one array of control bytes and then the matching elements, instead of chasing the nodes of std::unordered_set.
+   * Inserting can move the elements, so unlike std::unordered_set it does not keep references to them valid.
+   */
+  template <typename T, typename THash = Hash<T>, typename TEqual = std::equal_to<T>, typename Allocator = std::allocator<T>>
+  class flat_hash_set {
+  private:
+    using underlying_representation = _details_::FlatHashTable<T, T, _details_::IdentityKey, THash, TEqual, Allocator>;
+
+  public:
+    using allocator_type = Allocator;
+    // Elements are immutable so that their hashes stay correct, as in std::unordered_set.
+    using iterator = typename underlying_representation::const_iterator;
+    using const_iterator = typename underlying_representation::const_iterator;
+
+    flat_hash_set() = default;
+    flat_hash_set(flat_hash_set const&) = default;
+    flat_hash_set(flat_hash_set&&) = default;
+    explicit flat_hash_set(Allocator const& allocator) : set(allocator) {}
+    template <typename InputIt>
+    flat_hash_set(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : set(allocator) {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+    }
+    flat_hash_set(std::initializer_list<T> init) : flat_hash_set(init.begin(), init.end()) {}
+    ~flat_hash_set() = default;
+
+    flat_hash_set& operator=(flat_hash_set const&) = default;
+    flat_hash_set& operator=(flat_hash_set&&) = default;
+    flat_hash_set& operator=(std::initializer_list<T> init) {
+      return *this = flat_hash_set(init);
+    }
+
+    bool operator==(flat_hash_set const& rhs) const {
+      if (size() != rhs.size()) {
+        return false;
+      }
+      for (auto const& value : set) {
+        if (rhs.count(value) == 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+    bool operator!=(flat_hash_set const& rhs) const {
+      return !(*this == rhs);
+    }
+
+    allocator_type get_allocator() const {
+      return set.get_allocator();
+    }
+
+    iterator begin() {
+      return set.begin();
+    }
+    const_iterator begin() const {
+      return set.begin();
+    }
+    const_iterator cbegin() const {
+      return set.begin();
+    }
+
+    iterator end() {
+      return set.end();
+    }
+    const_iterator end() const {
+      return set.end();
+    }
+    const_iterator cend() const {
+      return set.end();
+    }
+
+    iterator find(const T& value) {
+      return static_cast<underlying_representation const&>(set).find(value);
+    }
+    const_iterator find(const T& value) const {
+      return set.find(value);
+    }
+
+    std::pair<iterator,bool> insert(const T& value) {
+      return set.findOrConstruct(value, [&value](void* slot) { new (slot) T(value); });
+    }
+    std::pair<iterator,bool> insert(T&& value) {
+      return set.findOrConstruct(value, [&value](void* slot) { new (slot) T(std::move(value)); });
+    }
+
+    template <typename... Args>
+    std::pair<iterator,bool> emplace(Args&&... args) {
+      return insert(T(std::forward<Args>(args)...));
+    }
+
+    iterator erase(const_iterator pos) {
+      return set.erase(pos);
+    }
+    size_t erase(const T& value) {
+      return set.erase(value);
+    }
+
+    void clear() {
+      set.clear();
+    }
+
+    size_t count(const T& value) const {
+      return find(value) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+      return set.size();
+    }
+    bool empty() const {
+      return set.empty();
+    }
+
+  private:
+    underlying_representation set;
+  };
+}
+
+#endif
@@ -0,0 +1,541 @@
+#ifndef FLAT_HASH_TABLE_HH
+#define FLAT_HASH_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MC_FLAT_HASH_SSE2 1
+#endif
+
+#include "hash.hh"
+
+namespace mc {
+  namespace _details_ {
+    /**
+     * Every slot of a FlatHashTable has a control byte, kept in a separate array so that a whole group of them
+     * can be checked at once. A full slot's control byte holds the low 7 bits of its element's hash, so it is never negative.
+     * An erased slot is marked deleted rather than empty when a probe sequence may have passed over it.
+     */
+    using ControlByte = std::int8_t;
+    constexpr ControlByte EmptyControl = -128;  // 0b10000000
+    constexpr ControlByte DeletedControl = -2;  // 0b11111110
+
+    inline bool IsFull(ControlByte control) {
+      return control >= 0;
+    }
+
+    // The positions of the set bits of a group's match mask. Each slot of the group has a bit every 2^Shift bits.
+    template <typename T, unsigned Width, unsigned Shift>
+    class BitMask {
+    public:
+      explicit BitMask(T mask) : mask(mask) {}
+
+      explicit operator bool() const {
+        return mask != 0;
+      }
+
+      // The mask is iterated over as the positions of its set bits, lowest first.
+      BitMask begin() const {
+        return *this;
+      }
+      BitMask end() const {
+        return BitMask(0);
+      }
+      bool operator!=(BitMask const& rhs) const {
+        return mask != rhs.mask;
+      }
+      unsigned operator*() const {
+        return trailingZeros();
+      }
+      BitMask& operator++() {
+        mask &= mask - 1;
+        return *this;
+      }
+
+      // Number of unset positions below the lowest set one. The mask must not be 0.
+      unsigned trailingZeros() const {
+        return static_cast<unsigned>(__builtin_ctzll(static_cast<std::uint64_t>(mask))) >> Shift;
+      }
+      // Number of unset positions above the highest set one. The mask must not be 0.
+      unsigned leadingZeros() const {
+        constexpr unsigned unusedBits = 64 - (Width << Shift);
+        return (static_cast<unsigned>(__builtin_clzll(static_cast<std::uint64_t>(mask))) - unusedBits) >> Shift;
+      }
+
+    private:
+      T mask;
+    };
+
+#ifdef MC_FLAT_HASH_SSE2
+    // The control bytes of Width consecutive slots, compared all at once with SSE2.
+    class Group {
+    public:
+      static constexpr size_t Width = 16;
+      using Mask = BitMask<std::uint32_t, Width, 0>;
+
+      explicit Group(ControlByte const* controls)
+        : controls(_mm_loadu_si128(reinterpret_cast<__m128i const*>(controls)))
+        {}
+
+      // Slots whose control byte is h2. These are the only slots that may hold an element with that hash.
+      Mask match(ControlByte h2) const {
+        return Mask(movemask(_mm_cmpeq_epi8(_mm_set1_epi8(h2), controls)));
+      }
+      Mask matchEmpty() const {
+        return match(EmptyControl);
+      }
+      Mask matchEmptyOrDeleted() const {
+        return Mask(movemask(_mm_cmpgt_epi8(_mm_set1_epi8(-1), controls)));
+      }
+
+    private:
+      static std::uint32_t movemask(__m128i bytes) {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+      }
+
+      __m128i controls;
+    };
+#else
+    // The control bytes of Width consecutive slots, compared all at once as bytes of a 64 bit word.
+    class Group {
+    public:
+      static constexpr size_t Width = 8;
+      using Mask = BitMask<std::uint64_t, Width, 3>;
+
+      explicit Group(ControlByte const* controls) {
+        std::memcpy(&this->controls, controls, sizeof(this->controls));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        this->controls = __builtin_bswap64(this->controls);
+#endif
+      }
+
+      // Slots whose control byte is h2. Can also report a slot right after a real match, which the caller's
+      // equality check filters out.
+      Mask match(ControlByte h2) const {
+        std::uint64_t x = controls ^ (LowBits * static_cast<std::uint8_t>(h2));
+        return Mask((x - LowBits) & ~x & HighBits);
+      }
+      Mask matchEmpty() const {
+        return Mask(controls & ~(controls << 6) & HighBits);
+      }
+      Mask matchEmptyOrDeleted() const {
+        return Mask(controls & ~(controls << 7) & HighBits);
+      }
+
+    private:
+      static constexpr std::uint64_t LowBits = 0x0101010101010101ULL;
+      static constexpr std::uint64_t HighBits = 0x8080808080808080ULL;
+
+      std::uint64_t controls;
+    };
+#endif
+
+    // Quadratic probing over whole groups, which visits every group of a power of two sized table exactly once.
+    class ProbeSequence {
+    public:
+      ProbeSequence(size_t hash, size_t mask)
+        : mask(mask),
+          position(hash & mask),
+          step(0)
+        {}
+
+      size_t offset() const {
+        return position;
+      }
+      size_t offset(size_t i) const {
+        return (position + i) & mask;
+      }
+      void next() {
+        step += Group::Width;
+        position = (position + step) & mask;
+      }
+
+    private:
+      size_t mask;
+      size_t position;
+      size_t step;
+    };
+
+    /**
+     * An open addressing hash table in the style of Google's Swiss tables, shared by flat_hash_set and flat_hash_map.
+     * Elements live directly in one array of slots rather than in separately allocated nodes, and a lookup checks
+     * the control bytes of a whole group of slots with a few instructions before touching any element.
+     * KeyOf extracts the key from a stored Value.
+     * Unlike the std containers, inserting can move elements, which invalidates iterators and references to them.
+     * Both arrays come from Allocator.
+     */
+    template <typename Value, typename Key, typename KeyOf, typename THash, typename TEqual, typename Allocator = std::allocator<Value>>
+    class FlatHashTable {
+    private:
+      using ControlAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<ControlByte>;
+      using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Value>;
+
+    public:
+      template <bool Const>
+      class Iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, Value const*, Value*>;
+        using reference = std::conditional_t<Const, Value const&, Value&>;
+
+        Iterator() = default;
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(Iterator<false> const& other) : table(other.table), index(other.index) {}
+
+        reference operator*() const {
+          return table->slots[index];
+        }
+        pointer operator->() const {
+          return &table->slots[index];
+        }
+
+        Iterator& operator++() {
+          index = table->nextFull(index + 1);
+          return *this;
+        }
+        Iterator operator++(int) {
+          Iterator old = *this;
+          ++*this;
+          return old;
+        }
+
+        bool operator==(Iterator const& rhs) const {
+          return index == rhs.index;
+        }
+        bool operator!=(Iterator const& rhs) const {
+          return index != rhs.index;
+        }
+
+      private:
+        friend class FlatHashTable;
+        template <bool> friend class Iterator;
+
+        using TablePointer = std::conditional_t<Const, FlatHashTable const*, FlatHashTable*>;
+
+        Iterator(TablePointer table, size_t index) : table(table), index(index) {}
+
+        TablePointer table = nullptr;
+        size_t index = 0;
+      };
+
+      using iterator = Iterator<false>;
+      using const_iterator = Iterator<true>;
+
+      FlatHashTable() = default;
+      explicit FlatHashTable(Allocator const& allocator) : allocator(allocator) {}
+
+      FlatHashTable(FlatHashTable const& other)
+        : FlatHashTable(other, std::allocator_traits<Allocator>::select_on_container_copy_construction(other.allocator))
+        {}
+      // Copies the elements of other into arrays from allocator.
+      FlatHashTable(FlatHashTable const& other, Allocator const& allocator) : allocator(allocator) {
+        insertAll(other);
+      }
+
+      FlatHashTable(FlatHashTable&& other) noexcept : allocator(other.allocator) {
+        swapContents(other);
+      }
+
+      ~FlatHashTable() {
+        destroyElements();
+        deallocate();
+      }
+
+      // Neither std::allocator nor std::pmr::polymorphic_allocator propagate on assignment, so a table keeps its allocator
+      // and only takes over the arrays of a table whose allocator is equal to its own. Otherwise the elements are moved one by one.
+      FlatHashTable& operator=(FlatHashTable const& other) {
+        if (this != &other) {
+          FlatHashTable copy(other, allocator);
+          swapContents(copy);
+        }
+        return *this;
+      }
+      FlatHashTable& operator=(FlatHashTable&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value) {
+        if (this != &other) {
+          FlatHashTable moved(allocator);
+          if (allocator == other.allocator) {
+            moved.swapContents(other);
+          } else {
+            moved.insertAll(std::move(other));
+          }
+          swapContents(moved);
+        }
+        return *this;
+      }
+
+      Allocator get_allocator() const {
+        return allocator;
+      }
+
+      iterator begin() {
+        return iterator(this, nextFull(0));
+      }
+      const_iterator begin() const {
+        return const_iterator(this, nextFull(0));
+      }
+      iterator end() {
+        return iterator(this, capacity);
+      }
+      const_iterator end() const {
+        return const_iterator(this, capacity);
+      }
+
+      iterator find(Key const& key) {
+        return iterator(this, findIndex(key, hashOf(key)));
+      }
+      const_iterator find(Key const& key) const {
+        return const_iterator(this, findIndex(key, hashOf(key)));
+      }
+
+      // Finds the element with the given key, or calls construct(slot) to placement construct one with that key in slot.
+      // Returns an iterator to the element and whether it was constructed.
+      template <typename Construct>
+      std::pair<iterator,bool> findOrConstruct(Key const& key, Construct&& construct) {
+        size_t hash = hashOf(key);
+        size_t index = findIndex(key, hash);
+        if (index != capacity) {
+          return std::make_pair(iterator(this, index), false);
+        }
+        index = prepareInsert(hash);
+        // key may be moved from by construct, so only the hash is used after this point.
+        construct(static_cast<void*>(&slots[index]));
+        commitInsert(index, hash);
+        return std::make_pair(iterator(this, index), true);
+      }
+
+      iterator erase(const_iterator pos) {
+        size_t index = pos.index;
+        eraseAt(index);
+        return iterator(this, nextFull(index + 1));
+      }
+      size_t erase(Key const& key) {
+        size_t index = findIndex(key, hashOf(key));
+        if (index == capacity) {
+          return 0;
+        }
+        eraseAt(index);
+        return 1;
+      }
+
+      void clear() {
+        if (numElements == 0) {
+          return;
+        }
+        destroyElements();
+        std::memset(controls, EmptyControl, capacity + Group::Width);
+        numElements = 0;
+        growthLeft = MaxLoad(capacity);
+      }
+
+      size_t size() const {
+        return numElements;
+      }
+      bool empty() const {
+        return numElements == 0;
+      }
+
+    private:
+      // Tables never have fewer slots than a group, so that every group load stays within the control bytes.
+      static constexpr size_t MinCapacity = Group::Width;
+
+      // The table grows once 7/8 of its slots are used, which keeps probe sequences short
+      // and guarantees every probe sequence reaches an empty slot.
+      static size_t MaxLoad(size_t capacity) {
+        return capacity - capacity / 8;
+      }
+
+      static size_t hashOf(Key const& key) {
+        return MixHash(THash{}(key));
+      }
+      static size_t H1(size_t hash) {
+        return hash >> 7;
+      }
+      static ControlByte H2(size_t hash) {
+        return static_cast<ControlByte>(hash & 0x7f);
+      }
+
+      size_t nextFull(size_t index) const {
+        while (index < capacity && !IsFull(controls[index])) {
+          ++index;
+        }
+        return index;
+      }
+
+      // The index of the element with the given key, or capacity if there is none.
+      size_t findIndex(Key const& key, size_t hash) const {
+        if (capacity == 0) {
+          return capacity;
+        }
+        ProbeSequence sequence(H1(hash), capacity - 1);
+        while (true) {
+          Group group(controls + sequence.offset());
+          for (unsigned i : group.match(H2(hash))) {
+            size_t index = sequence.offset(i);
+            if (TEqual{}(KeyOf{}(slots[index]), key)) {
+              return index;
+            }
+          }
+          if (group.matchEmpty()) {
+            return capacity;
+          }
+          sequence.next();
+        }
+      }
+
+      // The first empty or deleted slot on the probe sequence of hash.
+      size_t findFreeSlot(size_t hash) const {
+        ProbeSequence sequence(H1(hash), capacity - 1);
+        while (true) {
+          auto mask = Group(controls + sequence.offset()).matchEmptyOrDeleted();
+          if (mask) {
+            return sequence.offset(mask.trailingZeros());
+          }
+          sequence.next();
+        }
+      }
+
+      // Finds the slot a new element with the given hash goes in, growing the table first if it is out of empty slots.
+      size_t prepareInsert(size_t hash) {
+        if (capacity == 0) {
+          allocate(MinCapacity);
+        }
+        size_t index = findFreeSlot(hash);
+        if (growthLeft == 0 && controls[index] == EmptyControl) {
+          // Mostly deleted slots get reclaimed by rehashing at the same size, otherwise the table doubles.
+          resize(numElements < MaxLoad(capacity) / 2 ? capacity : capacity * 2);
+          index = findFreeSlot(hash);
+        }
+        return index;
+      }
+
+      void commitInsert(size_t index, size_t hash) {
+        if (controls[index] == EmptyControl) {
+          --growthLeft;
+        }
+        setControl(index, H2(hash));
+        ++numElements;
+      }
+
+      void eraseAt(size_t index) {
+        slots[index].~Value();
+        --numElements;
+
+        // If every window of Width slots around index has an empty slot, no probe sequence ever continued past index
+        // because of it, so it can be marked empty again instead of deleted.
+        size_t indexBefore = (index - Group::Width) & (capacity - 1);
+        auto emptyAfter = Group(controls + index).matchEmpty();
+        auto emptyBefore = Group(controls + indexBefore).matchEmpty();
+        bool wasNeverFull = emptyBefore && emptyAfter
+          && emptyAfter.trailingZeros() + emptyBefore.leadingZeros() < Group::Width;
+        if (wasNeverFull) {
+          ++growthLeft;
+        }
+        setControl(index, wasNeverFull ? EmptyControl : DeletedControl);
+      }
+
+      // The last Width control bytes mirror the first Width so that a group can be loaded starting at any slot.
+      void setControl(size_t index, ControlByte control) {
+        controls[index] = control;
+        if (index < Group::Width) {
+          controls[capacity + index] = control;
+        }
+      }
+
+      void resize(size_t newCapacity) {
+        ControlByte* oldControls = controls;
+        Value* oldSlots = slots;
+        size_t oldCapacity = capacity;
+
+        allocate(newCapacity);
+        numElements = 0;
+        for (size_t i = 0; i < oldCapacity; ++i) {
+          if (IsFull(oldControls[i])) {
+            size_t hash = hashOf(KeyOf{}(oldSlots[i]));
+            size_t index = findFreeSlot(hash);
+            new (&slots[index]) Value(std::move_if_noexcept(oldSlots[i]));
+            oldSlots[i].~Value();
+            commitInsert(index, hash);
+          }
+        }
+        deallocate(oldControls, oldSlots, oldCapacity);
+      }
+
+      // Replaces the arrays with new empty ones of the given capacity, without releasing the old ones.
+      void allocate(size_t newCapacity) {
+        controls = ControlAllocator(allocator).allocate(newCapacity + Group::Width);
+        std::memset(controls, EmptyControl, newCapacity + Group::Width);
+        slots = SlotAllocator(allocator).allocate(newCapacity);
+        capacity = newCapacity;
+        growthLeft = MaxLoad(newCapacity);
+      }
+
+      // Fills this empty table with copies of the elements of other, or moves them if other is an rvalue.
+      template <typename Other>
+      void insertAll(Other&& other) {
+        if (other.numElements == 0) {
+          return;
+        }
+        allocate(other.capacity);
+        for (auto& value : other) {
+          size_t hash = hashOf(KeyOf{}(value));
+          size_t index = findFreeSlot(hash);
+          if constexpr (std::is_const_v<std::remove_reference_t<Other>> || std::is_lvalue_reference_v<Other>) {
+            new (&slots[index]) Value(value);
+          } else {
+            new (&slots[index]) Value(std::move(value));
+          }
+          commitInsert(index, hash);
+        }
+      }
+
+      // Swaps everything but the allocators.
+      void swapContents(FlatHashTable& other) noexcept {
+        std::swap(controls, other.controls);
+        std::swap(slots, other.slots);
+        std::swap(capacity, other.capacity);
+        std::swap(numElements, other.numElements);
+        std::swap(growthLeft, other.growthLeft);
+      }
+
+      void destroyElements() {
+        if (!std::is_trivially_destructible_v<Value>) {
+          for (size_t i = 0; i < capacity; ++i) {
+            if (IsFull(controls[i])) {
+              slots[i].~Value();
+            }
+          }
+        }
+      }
+
+      void deallocate() {
+        if (capacity != 0) {
+          deallocate(controls, slots, capacity);
+        }
+      }
+      void deallocate(ControlByte* oldControls, Value* oldSlots, size_t oldCapacity) {
+        ControlAllocator(allocator).deallocate(oldControls, oldCapacity + Group::Width);
+        SlotAllocator(allocator).deallocate(oldSlots, oldCapacity);
+      }
+
+      [[no_unique_address]] Allocator allocator;
+      ControlByte* controls = nullptr;
+      Value* slots = nullptr;
+      size_t capacity = 0;
+      size_t numElements = 0;
+      // Number of empty slots that can still be filled before the table has to grow.
+      size_t growthLeft = 0;
+    };
+  }
+}
+
+#endif
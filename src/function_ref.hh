@@ -0,0 +1,36 @@
+#ifndef FUNCTION_REF_HH
+#define FUNCTION_REF_HH
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace mc {
+  template <typename Signature>
+  class FunctionRef;
+
+  // A non-owning reference to a callable, like a std::function that never allocates or copies the callable.
+  // The referenced callable must outlive the FunctionRef, so it is meant for callback parameters rather than for storage.
+  template <typename R, typename... Args>
+  class FunctionRef<R(Args...)> {
+  public:
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, FunctionRef>
+                                                      && std::is_invocable_r_v<R, F&, Args...>>>
+    FunctionRef(F&& f)
+      : callable(const_cast<void*>(static_cast<void const*>(std::addressof(f)))),
+        invoke([](void* callable, Args... args) -> R {
+          return (*static_cast<std::remove_reference_t<F>*>(callable))(std::forward<Args>(args)...);
+        })
+      {}
+
+    R operator()(Args... args) const {
+      return invoke(callable, std::forward<Args>(args)...);
+    }
+
+  private:
+    void* callable;
+    R (*invoke)(void*, Args...);
+  };
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef GENERALIZED_BUCHI_HH
+#define GENERALIZED_BUCHI_HH
+
+#include <bitset>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "auto_set.hh"
+#include "buchi.hh"
+#include "function_ref.hh"
+
+namespace mc {
+  // The largest number of acceptance sets a GeneralizedBuchi may have.
+  constexpr size_t MaxAcceptanceSets = 64;
+
+  // The acceptance sets a state belongs to. Bit i is set if the state is in acceptance set i.
+  using AcceptanceMarks = std::bitset<MaxAcceptanceSets>;
+
+  // A Buchi automaton with multiple acceptance sets. A run is accepting if it visits every acceptance set infinitely often.
+  // Having no acceptance sets at all means every infinite run is accepting.
+  // Like Buchi, its functions are type erased unless their types are given as Transitions and Marks (see MakeGeneralizedBuchi).
+  template <typename State, typename Alphabet,
+            typename Transitions = std::function<void(State const&, FunctionRef<void(Alphabet const&, State const&)>)>,
+            typename Marks = std::function<AcceptanceMarks(State const&)>>
+  class GeneralizedBuchi {
+  public:
+    using StateType = State;
+    using AlphabetType = Alphabet;
+    using StateSet = auto_set<State>;
+    using TransitionSet = auto_set<std::pair<Alphabet,State>>;
+    using StateTransitions = std::function<TransitionSet(State const&)>;
+    // See Buchi::TransitionVisitor and Buchi::StateTransitionVisitor.
+    using TransitionVisitor = FunctionRef<void(Alphabet const&, State const&)>;
+    using StateTransitionVisitor = std::function<void(State const&, TransitionVisitor)>;
+    using StateMarks = std::function<AcceptanceMarks(State const&)>;
+
+
+    GeneralizedBuchi(StateSet initialStates, Transitions transitions, size_t numAcceptanceSets, Marks stateMarks)
+      : initialStates(initialStates),
+        transitions(transitions),
+        numAcceptanceSets(numAcceptanceSets),
+        stateMarks(stateMarks)
+      {
+        checkNumAcceptanceSets();
+      }
+
+    // Defines the transitions by returning a TransitionSet for every state. Only type erased automata can be defined this way.
+    GeneralizedBuchi(StateSet initialStates, StateTransitions stateTransitions, size_t numAcceptanceSets, StateMarks stateMarks)
+      : initialStates(initialStates),
+        transitions([stateTransitions](State const& state, TransitionVisitor visit) {
+          for (auto const& [label, next] : stateTransitions(state)) {
+            visit(label, next);
+          }
+        }),
+        numAcceptanceSets(numAcceptanceSets),
+        stateMarks(stateMarks)
+      {
+        checkNumAcceptanceSets();
+      }
+
+    GeneralizedBuchi(GeneralizedBuchi const&) = default;
+    GeneralizedBuchi(GeneralizedBuchi&&) = default;
+    ~GeneralizedBuchi() = default;
+
+    GeneralizedBuchi& operator=(GeneralizedBuchi const&) = default;
+    GeneralizedBuchi& operator=(GeneralizedBuchi&&) = default;
+
+
+    const StateSet& getInitialStates() const {
+      return initialStates;
+    }
+
+    bool initial(State const& state) const {
+      return static_cast<bool>(initialStates.count(state));
+    }
+
+    TransitionSet getTransitions(State const& state) const {
+      TransitionSet transitionSet;
+      forEachTransition(state, [&transitionSet](Alphabet const& label, State const& next) {
+        transitionSet.emplace(label, next);
+      });
+      return transitionSet;
+    }
+
+    // See Buchi::forEachTransition.
+    template <typename F>
+    void forEachTransition(State const& state, F const& f) const {
+      transitions(state, f);
+    }
+
+    AcceptanceMarks getMarks(State const& state) const {
+      return stateMarks(state);
+    }
+
+    size_t getNumAcceptanceSets() const {
+      return numAcceptanceSets;
+    }
+
+    // The marks a cycle has to collect to be accepting.
+    AcceptanceMarks allMarks() const {
+      AcceptanceMarks all;
+      for (size_t i = 0; i < numAcceptanceSets; ++i) {
+        all.set(i);
+      }
+      return all;
+    }
+
+  private:
+    void checkNumAcceptanceSets() const {
+      if (numAcceptanceSets > MaxAcceptanceSets) {
+        throw std::length_error("A generalized Buchi automaton may have at most "+std::to_string(MaxAcceptanceSets)+" acceptance sets.");
+      }
+    }
+
+    StateSet initialStates;
+    Transitions transitions;
+    size_t numAcceptanceSets;
+    Marks stateMarks;
+  };
+
+  // Builds a generalized Buchi automaton that keeps the types of its transition function and acceptance marks. See Buchi.
+  template <typename State, typename Alphabet, typename Transitions, typename Marks>
+  GeneralizedBuchi<State, Alphabet, Transitions, Marks> MakeGeneralizedBuchi(auto_set<State> initialStates, Transitions transitions,
+                                                                             size_t numAcceptanceSets, Marks marks) {
+    return GeneralizedBuchi<State, Alphabet, Transitions, Marks>(std::move(initialStates), std::move(transitions), numAcceptanceSets, std::move(marks));
+  }
+
+  // Erases the types of the functions of a generalized Buchi automaton. See EraseTypes(Buchi).
+  template <typename S, typename A, typename... Fs>
+  GeneralizedBuchi<S,A> EraseTypes(GeneralizedBuchi<S,A,Fs...> const& gBuchi) {
+    if constexpr (std::is_same_v<GeneralizedBuchi<S,A,Fs...>, GeneralizedBuchi<S,A>>) {
+      return gBuchi;
+    } else {
+      return GeneralizedBuchi<S,A>(gBuchi.getInitialStates(),
+                                   [gBuchi](S const& s, typename GeneralizedBuchi<S,A>::TransitionVisitor visit) { gBuchi.forEachTransition(s, visit); },
+                                   gBuchi.getNumAcceptanceSets(),
+                                   [gBuchi](S const& s) { return gBuchi.getMarks(s); });
+    }
+  }
+
+  // Views a Buchi automaton as a generalized Buchi automaton with a single acceptance set.
+  template <typename S, typename A, typename... Fs>
+  auto ToGeneralized(Buchi<S,A,Fs...> const& buchi) {
+    return MakeGeneralizedBuchi<S,A>(buchi.getInitialStates(),
+                                     [buchi](S const& s, auto const& visit) { buchi.forEachTransition(s, visit); },
+                                     1,
+                                     [buchi](S const& s) { return AcceptanceMarks(buchi.accepting(s) ? 1 : 0); });
+  }
+
+  // Converts a generalized Buchi automaton into an equivalent Buchi automaton.
+  // The second component of each state counts how many acceptance sets, in order, have been visited since the last accepting state.
+  template <typename S, typename A, typename... Fs>
+  auto Degeneralize(GeneralizedBuchi<S,A,Fs...> const& gBuchi) {
+    using DegenStateType = std::pair<S, size_t>;
+
+    auto_set<DegenStateType> degenInitialStates;
+    for (auto const& s : gBuchi.getInitialStates()) {
+      degenInitialStates.emplace(s, 0);
+    }
+
+    auto degenAcceptingStates = [N = gBuchi.getNumAcceptanceSets()](DegenStateType const& s) {
+      return s.second == N;
+    };
+
+    auto degenStateTransitions = [gBuchi](DegenStateType const& s, auto const& visit) {
+      auto const& [state, index] = s;
+      size_t N = gBuchi.getNumAcceptanceSets();
+
+      gBuchi.forEachTransition(state, [&](A const& label, S const& next) {
+        size_t y = (index == N) ? 0 : index;
+        AcceptanceMarks marks = gBuchi.getMarks(next);
+        while (y < N && marks.test(y)) {
+          y++;
+        }
+        visit(label, std::make_pair(next, y));
+      });
+    };
+
+    return MakeBuchi<DegenStateType, A>(degenInitialStates, degenStateTransitions, degenAcceptingStates);
+  }
+
+  // Calculates the intersection of two generalized Buchi automata. M must be a functor with bool operator()(A1 const&, A2 const&) that determines if an element of A1 and an element of A2 are a "match".
+  // The acceptance sets of the intersection are the acceptance sets of b1 followed by those of b2, so no counter is needed in the product states.
+  // The intersection keeps the types of the functions of b1, b2 and labelMatch, so expanding a product state calls them directly.
+  template <typename S1, typename S2, typename A1, typename A2, typename... Fs1, typename... Fs2, typename M>
+  auto Intersection(GeneralizedBuchi<S1,A1,Fs1...> const& b1, GeneralizedBuchi<S2,A2,Fs2...> const& b2, M const& labelMatch) {
+    using InterStateType = std::pair<S1, S2>;
+
+    // Initial state construction
+    auto_set<InterStateType> interInitialStates;
+    for (auto const& s1 : b1.getInitialStates()) {
+      for (auto const& s2 : b2.getInitialStates()) {
+        interInitialStates.emplace(s1, s2);
+      }
+    }
+
+    // Definition of acceptance marks
+    auto interStateMarks = [b1,b2](InterStateType const& s) {
+      return b1.getMarks(s.first) | (b2.getMarks(s.second) << b1.getNumAcceptanceSets());
+    };
+
+    // Definition of state transition function
+    // The transitions of b2 are enumerated again for every transition of b1, so b2 should be the automaton whose transitions are cheaper to visit.
+    auto interStateTransitions = [b1,b2,labelMatch](InterStateType const& s, auto const& visit) {
+      b1.forEachTransition(s.first, [&](A1 const& label1, S1 const& head1) {
+        b2.forEachTransition(s.second, [&](A2 const& label2, S2 const& head2) {
+          if (labelMatch(label1,label2)) {
+            visit(label1, std::make_pair(head1, head2));
+          }
+        });
+      });
+    };
+
+    return MakeGeneralizedBuchi<InterStateType, A1>(interInitialStates, interStateTransitions,
+                                                    b1.getNumAcceptanceSets() + b2.getNumAcceptanceSets(), interStateMarks);
+  }
+
+  template <typename S1, typename S2, typename A, typename... Fs1, typename... Fs2>
+  auto Intersection(GeneralizedBuchi<S1,A,Fs1...> const& b1, GeneralizedBuchi<S2,A,Fs2...> const& b2) {
+    return Intersection(b1, b2, std::equal_to<A>{});
+  }
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef HASH_HH
+#define HASH_HH
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mc {
+  // The default allocator of auto_set is given here, as a default template argument may only be given once.
+  template <typename T, typename Allocator = std::allocator<T>>
+  class auto_set;
+
+  // The 64 bit finalizer of MurmurHash3. Spreads the bits of a hash so that similar inputs get unrelated hashes.
+  constexpr std::uint64_t MixHash(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Combines the hash of one more value into seed. The result depends on the order the values are combined in.
+  constexpr size_t HashCombine(size_t seed, size_t value) {
+    return MixHash(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+  }
+
+  /**
+   * Hash functor used by auto_set and auto_map. It covers:
+   *  - every type std::hash supports,
+   *  - std::pair, std::tuple and std::optional of hashable types,
+   *  - std::vector of hashable types, in order,
+   *  - std::set, std::unordered_set and auto_set of hashable types, independently of the order of the elements,
+   *  - any type with a member function size_t hash() const, which is how user types (e.g. states) opt in.
+   * Other types can opt in by specializing Hash. A type for which Hash has no operator() is not hashable.
+   * Values that are equal under == must have equal hashes.
+   */
+  template <typename T, typename = void>
+  struct Hash {};
+
+  namespace traits {
+    // Compile time check to see if a type supports hashing with mc::Hash using SFINAE
+    template <typename S, typename = void>
+    struct hashable : std::false_type {};
+    template <typename S>
+    struct hashable<S, std::void_t<decltype(Hash<S>{}(std::declval<S const&>()))>> : std::true_type {};
+
+    template <typename S, typename = void>
+    struct std_hashable : std::false_type {};
+    template <typename S>
+    struct std_hashable<S, std::void_t<decltype(std::hash<S>{}(std::declval<S const&>()))>> : std::true_type {};
+
+    template <typename S, typename = void>
+    struct has_hash_member : std::false_type {};
+    template <typename S>
+    struct has_hash_member<S, std::void_t<decltype(size_t(std::declval<S const&>().hash()))>> : std::true_type {};
+  }
+
+  namespace _details_ {
+    template <typename... Ts>
+    constexpr bool AllHashable = (traits::hashable<Ts>::value && ...);
+
+    template <typename Iter>
+    size_t HashOrdered(Iter first, Iter last) {
+      using T = std::decay_t<decltype(*first)>;
+      size_t seed = 0;
+      for (; first != last; ++first) {
+        seed = HashCombine(seed, Hash<T>{}(*first));
+      }
+      return seed;
+    }
+
+    // Sums the mixed hashes of the elements so that the result does not depend on the order the elements are visited in.
+    template <typename Iter>
+    size_t HashUnordered(Iter first, Iter last) {
+      using T = std::decay_t<decltype(*first)>;
+      size_t sum = 0;
+      size_t size = 0;
+      for (; first != last; ++first, ++size) {
+        sum += MixHash(Hash<T>{}(*first));
+      }
+      return HashCombine(sum, size);
+    }
+
+    template <typename Set>
+    struct UnorderedRangeHash {
+      size_t operator()(Set const& set) const {
+        return HashUnordered(set.begin(), set.end());
+      }
+    };
+  }
+
+  template <typename T>
+  struct Hash<T, std::enable_if_t<traits::std_hashable<T>::value>> {
+    size_t operator()(T const& value) const {
+      return std::hash<T>{}(value);
+    }
+  };
+
+  template <typename T>
+  struct Hash<T, std::enable_if_t<traits::has_hash_member<T>::value && !traits::std_hashable<T>::value>> {
+    size_t operator()(T const& value) const {
+      return value.hash();
+    }
+  };
+
+  template <typename T1, typename T2>
+  struct Hash<std::pair<T1,T2>, std::enable_if_t<_details_::AllHashable<T1,T2>>> {
+    size_t operator()(std::pair<T1,T2> const& value) const {
+      return HashCombine(Hash<T1>{}(value.first), Hash<T2>{}(value.second));
+    }
+  };
+
+  template <typename... Ts>
+  struct Hash<std::tuple<Ts...>, std::enable_if_t<_details_::AllHashable<Ts...>>> {
+    size_t operator()(std::tuple<Ts...> const& value) const {
+      return std::apply([](Ts const&... elements) {
+        size_t seed = 0;
+        ((seed = HashCombine(seed, Hash<Ts>{}(elements))), ...);
+        return seed;
+      }, value);
+    }
+  };
+
+  // std::hash already covers optionals of std::hash types, this covers optionals of every other hashable type.
+  template <typename T>
+  struct Hash<std::optional<T>, std::enable_if_t<traits::hashable<T>::value && !traits::std_hashable<std::optional<T>>::value>> {
+    size_t operator()(std::optional<T> const& value) const {
+      return value ? HashCombine(1, Hash<T>{}(*value)) : 0;
+    }
+  };
+
+  template <typename T, typename Alloc>
+  struct Hash<std::vector<T,Alloc>, std::enable_if_t<traits::hashable<T>::value && !traits::std_hashable<std::vector<T,Alloc>>::value>> {
+    size_t operator()(std::vector<T,Alloc> const& value) const {
+      return _details_::HashOrdered(value.begin(), value.end());
+    }
+  };
+
+  template <typename T, typename Compare, typename Alloc>
+  struct Hash<std::set<T,Compare,Alloc>, std::enable_if_t<traits::hashable<T>::value>>
+    : _details_::UnorderedRangeHash<std::set<T,Compare,Alloc>> {};
+
+  template <typename T, typename H, typename Eq, typename Alloc>
+  struct Hash<std::unordered_set<T,H,Eq,Alloc>, std::enable_if_t<traits::hashable<T>::value>>
+    : _details_::UnorderedRangeHash<std::unordered_set<T,H,Eq,Alloc>> {};
+
+  template <typename T, typename Allocator>
+  struct Hash<auto_set<T,Allocator>, std::enable_if_t<traits::hashable<T>::value>>
+    : _details_::UnorderedRangeHash<auto_set<T,Allocator>> {};
+}
+
+#endif
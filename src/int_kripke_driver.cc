@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
 
 #include "auto_set.hh"
+#include "auto_map.hh"
 #include "eq_function.hh"
 
 #include "parser.hh"
@@ -12,7 +15,9 @@
 
 #include "kripke.hh"
 #include "ltl.hh"
+#include "ltl_predicates.hh"
 #include "model_check.hh"
+#include "search_option_parser.hh"
 
 #include "buchi_printer.hh"
 
@@ -165,22 +170,30 @@ namespace parser {
   class IntAPParser {
   public:
     IntAPParser(int N)
-      : compParser(N)
+      : compParser(N),
+        atoms(std::make_shared<auto_map<std::string, AP>>())
       {}
     ~IntAPParser() = default;
 
     std::optional<Formula> operator()(ParserStream& pStream) {
       if (auto opt_func = compParser(pStream); opt_func) {
         auto& [func, funcStr] = *opt_func;
-        AP intAP (func);
-        intAP.setRepresentation(funcStr);
-        return std::make_optional(ltl::make_atomic<AP>(intAP));
+        // Comparisons written the same way are the same atomic proposition, rather than copies the translation would track separately.
+        auto iter = atoms->find(funcStr);
+        if (iter == atoms->end()) {
+          AP intAP (func);
+          intAP.setRepresentation(funcStr);
+          iter = atoms->emplace(funcStr, intAP).first;
+        }
+        return std::make_optional(ltl::make_atomic<AP>(iter->second));
       }
       return std::nullopt;
     }
 
   private:
     ComparisonParser compParser;
+    // Shared by the copies of the parser that the LTL parser makes.
+    std::shared_ptr<auto_map<std::string, AP>> atoms;
   };
 
   class IntKripkeParser {
@@ -328,19 +341,17 @@ namespace parser {
       };
 
       auto transitionVec = parseStar<TransSetType>(intTransitionParser, pStream);
-      auto kripkeTransitionFunc = [transitionVec, N = this->N] (int s) {
-        auto_set<int> toSet;
+      auto kripkeTransitionFunc = [transitionVec, N = this->N] (int s, Kripke<int>::SuccessorVisitor visit) {
         for (auto const& [fromFuncSet, toFuncSet] : transitionVec) {
           for (auto const& charFunc : fromFuncSet) {
             if (charFunc(s)) {
               for (auto const& transFunc : toFuncSet) {
                 auto t = transFunc(s);
-                toSet.insert(t % N);
+                visit(t % N);
               }
             }
           }
         }
-        return toSet;
       };
 
       return Kripke<int>(initSet, kripkeTransitionFunc, fairnessConstraints);
@@ -369,27 +380,94 @@ namespace parser {
   };
 }
 
+// Prints the Buchi automaton translation turns spec into, reduced if reduce is set.
+void PrintLTLBuchi(Formula const& spec, LTLTranslation translation, bool reduce) {
+  auto ltlBuchiAlphabetToString = [](auto labelSet) {
+    std::stringstream labelStream;
+    for (auto const& [truth, ap] : labelSet) {
+      if (!truth) labelStream << "(! ";
+      labelStream << ap;
+      if (!truth) labelStream << ")";
+      labelStream << ", ";
+    }
+    std::string labelStr = labelStream.str();
+    return "{" + labelStr.substr(0,labelStr.size()-2) + "}";
+  };
+  auto Print = [&](auto const& ltlBuchi) {
+    std::function<std::string(typename std::decay_t<decltype(ltlBuchi)>::AlphabetType)> alphabetToString = ltlBuchiAlphabetToString;
+    if (reduce) {
+      ReductionStatistics reductionStatistics;
+      auto reduced = ReduceBuchi(ltlBuchi, Simulation::Direct, &reductionStatistics);
+      std::cout << "LTL Buchi (reduced from " << reductionStatistics.statesBefore << " states and " << reductionStatistics.transitionsBefore
+                << " transitions to " << reductionStatistics.statesAfter << " and " << reductionStatistics.transitionsAfter << "):\n";
+      PrintBuchi(std::cout, reduced, alphabetToString);
+    } else {
+      std::cout << "LTL Buchi:\n";
+      PrintBuchi(std::cout, ltlBuchi, alphabetToString);
+    }
+  };
+  if (translation == LTLTranslation::Alternating) {
+    Print(ltl::VWAAToBuchi(spec));
+  } else {
+    Print(ltl::LTLToBuchi(spec));
+  }
+  std::cout << "\n";
+}
+
 void PrintUsage() {
-  std::cout << "Usage: collatz <ltl_filename> [modulo_int]\n";
+  std::cout << "Usage: collatz <ltl_filename> [modulo_int] [search options]\n";
   std::cout << "This will read the ltl specification provided in the ltl_filename and model check it on the reverse collatz graph modulo the modula_int parameter provided.\n";
   std::cout << "modulo_int must be greater than 0 and if it is not provided, it will default to the arbitrary number 1000.\n";
+  std::cout << "--ltl <tableau|lazy|vwaa> builds the whole tableau of the specification before the search (the default),\n";
+  std::cout << "only the part the search reaches, as it reaches it, or goes through a very weak alternating automaton as LTL2BA does.\n";
+  std::cout << "--ltl-stats prints how many nodes and transitions the translation of the specification made and how long it took.\n";
+  std::cout << "--reduce merges the states of the automaton of the specification that simulate each other and removes those that cannot\n";
+  std::cout << "reach an accepting cycle before it is intersected with the Kripke structure. Does not apply to --ltl lazy.\n";
+  parser::PrintSearchOptionsUsage();
 }
 
 int main(int argc, char* argv[]) {
   int N = 1000; // Arbitrary number
-  if (argc > 3) {
-    std::cout << "Too many arguments. Expected at most 2 but got " << argc - 1 << "\n\n";
+  std::vector<std::string> args(argv + 1, argv + argc);
+  SearchOptions searchOptions;
+  if (!parser::ParseSearchOptions(args, searchOptions)) {
+    PrintUsage();
+    return -1;
+  }
+  auto ltlStatsIter = std::find(args.begin(), args.end(), "--ltl-stats");
+  bool printLTLStats = ltlStatsIter != args.end();
+  if (printLTLStats) {
+    args.erase(ltlStatsIter);
+  }
+  auto reduceIter = std::find(args.begin(), args.end(), "--reduce");
+  bool reduce = reduceIter != args.end();
+  if (reduce) {
+    args.erase(reduceIter);
+  }
+  LTLTranslation translation = LTLTranslation::Tableau;
+  if (auto ltlIter = std::find(args.begin(), args.end(), "--ltl"); ltlIter != args.end()) {
+    auto opt_translation = (ltlIter + 1 == args.end()) ? std::nullopt : ParseLTLTranslation(*(ltlIter + 1));
+    if (!opt_translation) {
+      std::cout << "Expected tableau, lazy or vwaa after --ltl.\n";
+      PrintUsage();
+      return -1;
+    }
+    translation = *opt_translation;
+    args.erase(ltlIter, ltlIter + 2);
+  }
+  if (args.size() > 2) {
+    std::cout << "Too many arguments. Expected at most 2 but got " << args.size() << "\n\n";
     PrintUsage();
     return -1;
   }
-  if (argc == 1) {
+  if (args.empty()) {
     PrintUsage();
     return -1;
   }
   
-  if (argc == 3) {
+  if (args.size() == 2) {
     try {
-      N = std::stoi(argv[2]);
+      N = std::stoi(args[1]);
     } catch (std::exception e) {
       std::cout << "Could not parse argument. Must be a positive integer.\n";
       return -1;
@@ -401,9 +479,9 @@ int main(int argc, char* argv[]) {
   }
 
   std::ifstream stream;
-  stream.open(argv[1]);
+  stream.open(args[0]);
   if (!stream.good()) {
-    std::cout << "Failed to open file \"" << argv[1] << "\".\n";
+    std::cout << "Failed to open file \"" << args[0] << "\".\n";
     return -1;
   }
 
@@ -438,60 +516,33 @@ int main(int argc, char* argv[]) {
 
   auto spec = ltl::make_not(*opt_spec); // We negate so that we properly check for existence of counterexample
   std::cout << "Negated LTL: " << spec << "\n";
-  std::function<AP(AP)> notCompress = [](AP ap) {
-    AP notAP([ap](int s) { return !ap(s); });
-    notAP.setRepresentation("(! "+ap.getRepresentation()+")");
-    return notAP;
-  };
-  std::function<AP(AP,AP)> orCompress = [](AP ap1, AP ap2) {
-    AP orAP([ap1,ap2](int s) { return ap1(s) || ap2(s); });
-    orAP.setRepresentation("(|| "+ap1.getRepresentation()+" "+ap2.getRepresentation()+")");
-    return orAP;
-  };
-  std::function<AP(AP,AP)> andCompress = [](AP ap1, AP ap2) {
-    AP andAP([ap1,ap2](int s) { return ap1(s) && ap2(s); });
-    andAP.setRepresentation("(&& "+ap1.getRepresentation()+" "+ap2.getRepresentation()+")");
-    return andAP;
-  };
-
-  AP trueAP([](auto const& s) { return true; });
-  trueAP.setRepresentation("true");
-  AP falseAP([](auto const& s) { return false; });
-  falseAP.setRepresentation("false");
-  auto processedSpec = ltl::Compress(ltl::Normalize(spec, trueAP, falseAP), notCompress, orCompress, andCompress);
-  std::cout << "Normalized LTL: " << processedSpec << "\n";
-
-  auto ltlBuchi = ltl::LTLToBuchi(processedSpec);
-  std::cout << "LTL Buchi:\n";
-  std::function<std::string(typename decltype(ltlBuchi)::AlphabetType)> ltlBuchiAlphabetToString = [](auto labelSet) {
-    std::stringstream labelStream;
-    for (auto const& [truth, ap] : labelSet) {
-      if (!truth) labelStream << "(! ";
-      labelStream << ap;
-      if (!truth) labelStream << ")";
-      labelStream << ", ";
-    }
-    std::string labelStr = labelStream.str();
-    return "{" + labelStr.substr(0,labelStr.size()-2) + "}";
-  };
-  std::function<std::string(typename decltype(ltlBuchi)::StateType)> ltlBuchiStateToString = [](auto statePair) {
-    std::stringstream stateStream;
-    auto& [opt_state, index] = statePair;
-    stateStream << "(";
-    if (opt_state) {
-      stateStream << *opt_state;
-    } else {
-      stateStream << "INIT";
-    }
-    stateStream << ", " << index << ")";
-    return stateStream.str();
-  };
-  PrintBuchi(std::cout, ltlBuchi, ltlBuchiAlphabetToString);//, ltlBuchiStateToString);
-  std::cout << "\n";
+  // Boolean combinations of comparisons are compiled into flat programs, with combinations that appear more than once shared.
+  ltl::PredicateCompiler<AP> predicateCompiler;
+  auto simplifiedSpec = ltl::Simplify(spec);
+  std::cout << "Simplified LTL: " << simplifiedSpec << " (size " << ltl::FormulaSize(ltl::NegationNormalForm(spec)) << " -> " << ltl::FormulaSize(simplifiedSpec) << ")\n";
+  auto processedSpec = ltl::Compress(ltl::Normalize(simplifiedSpec), predicateCompiler);
+  std::cout << "Normalized LTL: " << processedSpec << " (" << processedSpec.getAPSet().size() << " atomic propositions)\n";
+
+  ModelCheckOptions modelCheckOptions(searchOptions);
+  modelCheckOptions.translation = translation;
+  modelCheckOptions.reduce = reduce;
+  // The lazy tableau is only built as far as the search reaches, so it is not printed in full.
+  if (translation != LTLTranslation::LazyTableau) {
+    PrintLTLBuchi(processedSpec, translation, reduce);
+  }
 
   auto kripke = *opt_kripke;
 
-  auto opt_lasso = ModelCheck(kripke, processedSpec);
+  SearchStatistics searchStatistics;
+  // Transitions lead to integers in (-N, N), and the initial states are not capped, so together they bound every state.
+  int lowestState = -(N - 1);
+  int highestState = N - 1;
+  for (int initState : kripke.getInitialStates()) {
+    lowestState = std::min(lowestState, initState);
+    highestState = std::max(highestState, initState);
+  }
+  ltl::TranslationStatistics translationStatistics;
+  auto opt_lasso = ModelCheck(kripke, IntegerDomain<int>(lowestState, highestState + 1), processedSpec, modelCheckOptions, &searchStatistics, &translationStatistics);
   if (opt_lasso) {
     std::cout << "The LTL specification does not hold.\n";
     const auto& [stem, loop] = *opt_lasso;
@@ -503,7 +554,21 @@ int main(int argc, char* argv[]) {
     for (auto state : loop) {
       std::cout << state << "\n";
     }
+  } else if (!searchStatistics.complete) {
+    std::cout << "No counterexample was found, but the search was incomplete so the LTL specification may not hold.\n";
   } else {
     std::cout << "The LTL specification holds.\n";
   }
+  if (printLTLStats) {
+    std::cout << "LTL translation: " << translationStatistics.tableauNodes << " tableau nodes ("
+              << translationStatistics.createdNodes << " made, " << translationStatistics.mergedNodes << " merged) and "
+              << translationStatistics.transitions << " transitions in "
+              << translationStatistics.seconds * 1000 << " ms.\n";
+    if (reduce && translation != LTLTranslation::LazyTableau) {
+      auto const& reduction = translationStatistics.reduction;
+      std::cout << "LTL reduction: " << reduction.statesBefore << " states and " << reduction.transitionsBefore << " transitions reduced to "
+                << reduction.statesAfter << " states and " << reduction.transitionsAfter << " transitions.\n";
+    }
+  }
+  parser::PrintSearchStatistics(searchOptions, searchStatistics);
 }
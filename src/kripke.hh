@@ -1,30 +1,68 @@
 #ifndef KRIPKE_HH
 #define KRIPKE_HH
 
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "auto_set.hh"
 #include "eq_function.hh"
+#include "function_ref.hh"
 
 namespace mc {
-
-  template <typename State, typename AP = EqFunction<bool(State const&)>>
+  namespace _details_ {
+    // The default labeling of a Kripke structure, which evaluates an atomic proposition by calling it on the state.
+    struct ApplyAP {
+      template <typename State, typename AP>
+      bool operator()(State const& state, AP const& ap) const {
+        return ap(state);
+      }
+    };
+  }
+
+  // A fair Kripke structure. Like Buchi, its successor function and labeling function are type erased
+  // unless their types are given as Successors and Labeling (see MakeKripke).
+  // successors(state, visit) must call visit(next) for every successor of state.
+  // The fairness constraints are always type erased, as a Kripke structure has any number of them.
+  template <typename State, typename AP = EqFunction<bool(State const&)>,
+            typename Successors = std::function<void(State const&, FunctionRef<void(State const&)>)>,
+            typename Labeling = std::function<bool(State const&, AP const&)>>
   class Kripke {
   public:
     using StateType = State;
     using APType = AP;
     using StateSet = auto_set<State>;
     using StateTransitions = std::function<auto_set<State>(State const&)>;
+    // Receives each successor of a state, in turn.
+    using SuccessorVisitor = FunctionRef<void(State const&)>;
+    // Passes every successor of a state to the visitor instead of collecting them in a set. A state may pass the same successor more than once.
+    using StateSuccessorVisitor = std::function<void(State const&, SuccessorVisitor)>;
     using StateCharFunc = std::function<bool(State const&)>;
     using LabelingFunc = std::function<bool(State const&, AP const&)>;
 
 
+    // Defines the transitions by returning a set for every state. Only type erased Kripke structures can be defined this way.
     Kripke(StateSet initialStates,
            StateTransitions stateTransitions,
            std::vector<StateCharFunc> fairnessConstraints = {},
-           LabelingFunc labelingFunction = [](State const& s, AP const& ap) {
-             return ap(s);
-           })
+           Labeling labelingFunction = _details_::ApplyAP())
+      : initialStates(initialStates),
+        successors([stateTransitions](State const& state, SuccessorVisitor visit) {
+          for (auto const& next : stateTransitions(state)) {
+            visit(next);
+          }
+        }),
+        fairnessConstraints(fairnessConstraints),
+        labelingFunction(labelingFunction)
+      {}
+
+    Kripke(StateSet initialStates,
+           Successors successors,
+           std::vector<StateCharFunc> fairnessConstraints = {},
+           Labeling labelingFunction = _details_::ApplyAP())
       : initialStates(initialStates),
-        stateTransitions(stateTransitions),
+        successors(successors),
         fairnessConstraints(fairnessConstraints),
         labelingFunction(labelingFunction)
       {}
@@ -46,7 +84,18 @@ namespace mc {
     }
 
     auto_set<State> getTransitions(State const& state) const {
-      return stateTransitions(state);
+      auto_set<State> successorSet;
+      forEachSuccessor(state, [&successorSet](State const& next) {
+        successorSet.insert(next);
+      });
+      return successorSet;
+    }
+
+    // Calls f(next) for each successor of state. The argument is only valid during the call.
+    // Unlike getTransitions this allocates nothing unless the transitions were defined with sets, but a successor may be visited more than once.
+    template <typename F>
+    void forEachSuccessor(State const& state, F const& f) const {
+      successors(state, f);
     }
 
     bool checkAP(State const& s, AP const& ap) const {
@@ -70,13 +119,40 @@ namespace mc {
       return fairnessConstraints[constraintNumber](state);
     }
 
+    std::vector<StateCharFunc> const& getConstraints() const {
+      return fairnessConstraints;
+    }
+
   private:
     StateSet initialStates;
-    StateTransitions stateTransitions;
+    Successors successors;
     std::vector<StateCharFunc> fairnessConstraints;
-    LabelingFunc labelingFunction;
+    Labeling labelingFunction;
   };
 
+  // Builds a Kripke structure that keeps the types of its successor and labeling functions. See Kripke.
+  template <typename State, typename AP, typename Successors, typename Labeling = _details_::ApplyAP>
+  Kripke<State, AP, Successors, Labeling> MakeKripke(auto_set<State> initialStates,
+                                                    Successors successors,
+                                                    std::vector<std::function<bool(State const&)>> fairnessConstraints = {},
+                                                    Labeling labelingFunction = Labeling()) {
+    return Kripke<State, AP, Successors, Labeling>(std::move(initialStates), std::move(successors),
+                                                   std::move(fairnessConstraints), std::move(labelingFunction));
+  }
+
+  // Erases the types of the functions of a Kripke structure. See EraseTypes(Buchi).
+  template <typename State, typename AP, typename... Fs>
+  Kripke<State, AP> EraseTypes(Kripke<State, AP, Fs...> const& kripke) {
+    if constexpr (std::is_same_v<Kripke<State, AP, Fs...>, Kripke<State, AP>>) {
+      return kripke;
+    } else {
+      return Kripke<State, AP>(kripke.getInitialStates(),
+                               [kripke](State const& s, typename Kripke<State, AP>::SuccessorVisitor visit) { kripke.forEachSuccessor(s, visit); },
+                               kripke.getConstraints(),
+                               [kripke](State const& s, AP const& ap) { return kripke.checkAP(s, ap); });
+    }
+  }
+
 }
 
 #endif
@@ -5,15 +5,15 @@
 
 #include "kripke.hh"
 #include "buchi.hh"
+#include "generalized_buchi.hh"
 
 namespace mc {
 
-  template <typename State, typename AP>
-  auto KripkeToBuchi(Kripke<State, AP> const& kripke, auto_set<AP> const& apSet) {
+  template <typename State, typename AP, typename... Fs>
+  auto KripkeToBuchi(Kripke<State, AP, Fs...> const& kripke, auto_set<AP> const& apSet) {
     // std::optional<State> is a cheap way to simulate State union {iota}
     // iota is represented by no value (i.e. by std::nullopt)
     using BuchiStateType = std::pair<std::optional<State>, size_t>;
-    using BuchiType = Buchi<BuchiStateType, auto_set<AP>>;
 
     // Initial state construction
     auto_set<BuchiStateType> buchiInitialStates;
@@ -25,15 +25,10 @@ namespace mc {
     };
 
     // Definition of state transition function
-    auto buchiStateTransitions = [kripke,apSet](BuchiStateType const& s) {
+    auto buchiStateTransitions = [kripke,apSet](BuchiStateType const& s, auto const& visit) {
       const auto&[optKripkeState, constraintIndex] = s;
 
-      auto_set<State> nextStates = optKripkeState ?
-        kripke.getTransitions(*optKripkeState)
-        : kripke.getInitialStates();
-
-      typename BuchiType::TransitionSet transitions;
-      for (const auto& next : nextStates) {
+      auto VisitNext = [&](State const& next) {
         size_t y = constraintIndex;
         if (constraintIndex == kripke.getNumConstraints()) {
           y = 0;
@@ -41,13 +36,58 @@ namespace mc {
           y++;
         }
 
-        transitions.emplace(kripke.getAPSubset(next, apSet),
-                            std::make_pair(std::make_optional(next), y));
+        visit(kripke.getAPSubset(next, apSet), std::make_pair(std::make_optional(next), y));
+      };
+      if (optKripkeState) {
+        kripke.forEachSuccessor(*optKripkeState, VisitNext);
+      } else {
+        for (auto const& init : kripke.getInitialStates()) {
+          VisitNext(init);
+        }
+      }
+    };
+
+    return MakeBuchi<BuchiStateType, auto_set<AP>>(buchiInitialStates, buchiStateTransitions, buchiAcceptingStates);
+  }
+
+  // Same as KripkeToBuchi except each fairness constraint becomes its own acceptance set,
+  // so the states of the result do not need the constraint counter.
+  template <typename State, typename AP, typename... Fs>
+  auto KripkeToGeneralizedBuchi(Kripke<State, AP, Fs...> const& kripke, auto_set<AP> const& apSet) {
+    // std::optional<State> is a cheap way to simulate State union {iota}
+    // iota is represented by no value (i.e. by std::nullopt)
+    using BuchiStateType = std::optional<State>;
+
+    // Initial state construction
+    auto_set<BuchiStateType> buchiInitialStates;
+    buchiInitialStates.emplace(std::nullopt);
+
+    // Definition of acceptance marks. A state is in acceptance set i if it satisfies the ith fairness constraint.
+    auto buchiStateMarks = [kripke](BuchiStateType const& s) {
+      AcceptanceMarks marks;
+      if (s) {
+        for (size_t i = 0; i < kripke.getNumConstraints(); ++i) {
+          marks.set(i, kripke.checkConstraint(i, *s));
+        }
+      }
+      return marks;
+    };
+
+    // Definition of state transition function
+    auto buchiStateTransitions = [kripke,apSet](BuchiStateType const& s, auto const& visit) {
+      auto VisitNext = [&](State const& next) {
+        visit(kripke.getAPSubset(next, apSet), std::make_optional(next));
+      };
+      if (s) {
+        kripke.forEachSuccessor(*s, VisitNext);
+      } else {
+        for (auto const& init : kripke.getInitialStates()) {
+          VisitNext(init);
+        }
       }
-      return transitions;
     };
 
-    return BuchiType(buchiInitialStates, buchiStateTransitions, buchiAcceptingStates);
+    return MakeGeneralizedBuchi<BuchiStateType, auto_set<AP>>(buchiInitialStates, buchiStateTransitions, kripke.getNumConstraints(), buchiStateMarks);
   }
 
 }
@@ -1,12 +1,21 @@
 #ifndef LTL_HH
 #define LTL_HH
 
-#include <variant>
-#include <utility>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <ostream>
 #include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "auto_set.hh"
+#include "auto_map.hh"
+#include "hash.hh"
 #include "eq_function.hh"
 #include "kripke.hh"
 
@@ -26,9 +35,12 @@ namespace mc {
     template <typename AP>
     class Formula;
 
+    template <typename AP>
+    class FormulaFactory;
+
     template <typename AP>
     Formula<AP> make_atomic(AP const& atomic) {
-      return Formula<AP>(atomic);
+      return Formula<AP>(FormulaFactory<AP>::instance().atomic(atomic));
     }
 
     template <typename F, typename AP>
@@ -38,39 +50,59 @@ namespace mc {
 
     template <typename AP>
     Formula<AP> make_not(Formula<AP> const& sub1) {
-      return Formula<AP>(FormulaForm::Not, sub1);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::Not, {sub1}));
     }
 
     template <typename AP>
     Formula<AP> make_or(Formula<AP> const& sub1, Formula<AP> const& sub2) {
-      return Formula<AP>(FormulaForm::Or, sub1, sub2);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::Or, {sub1, sub2}));
     }
 
     template <typename AP>
     Formula<AP> make_and(Formula<AP> const& sub1, Formula<AP> const& sub2) {
-      return Formula<AP>(FormulaForm::And, sub1, sub2);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::And, {sub1, sub2}));
     }
 
     template <typename AP>
     Formula<AP> make_global(Formula<AP> const& sub1) {
-      return Formula<AP>(FormulaForm::Global, sub1);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::Global, {sub1}));
     }
 
     template <typename AP>
     Formula<AP> make_future(Formula<AP> const& sub1) {
-      return Formula<AP>(FormulaForm::Future, sub1);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::Future, {sub1}));
     }
 
     template <typename AP>
     Formula<AP> make_until(Formula<AP> const& sub1, Formula<AP> const& sub2) {
-      return Formula<AP>(FormulaForm::Until, sub1, sub2);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::Until, {sub1, sub2}));
     }
 
     template <typename AP>
     Formula<AP> make_release(Formula<AP> const& sub1, Formula<AP> const& sub2) {
-      return Formula<AP>(FormulaForm::Release, sub1, sub2);
+      return Formula<AP>(FormulaFactory<AP>::instance().compound(FormulaForm::Release, {sub1, sub2}));
+    }
+
+    namespace _details_ {
+      // A node of the formula DAG. Nodes are made only by FormulaFactory and never change afterwards.
+      template <typename AP>
+      struct FormulaNode {
+        size_t id;
+        size_t hash;
+        FormulaForm form;
+        std::optional<AP> ap;
+        std::vector<Formula<AP>> children;
+        // Shared with a subformula whenever their atomic propositions are the same, so deep formulas do not copy the set at every level.
+        std::shared_ptr<auto_set<AP> const> apSet;
+      };
     }
 
+    /**
+     * Formulas are handles to nodes that are hash consed by FormulaFactory: building a formula that is structurally equal
+     * to one built before returns the node of that formula. So a formula is a DAG whose common subformulas are stored once,
+     * copying a formula copies a pointer, and comparing or hashing one takes constant time.
+     * A default constructed formula is empty and may only be assigned to.
+     */
     template <typename AP>
     class Formula {
     public:
@@ -81,42 +113,45 @@ namespace mc {
       Formula& operator=(Formula const&) = default;
       Formula& operator=(Formula&&) = default;
 
+      // Equal formulas share their node.
       bool operator==(Formula const& rhs) const {
-        if (this == &rhs) { return true; }
-        return formulaForm == rhs.formulaForm && children == rhs.children;
+        return node == rhs.node;
       }
 
       bool operator!=(Formula const& rhs) const {
         return !(*this == rhs);
       }
 
+      // Hashes the structure of the formula, computed once when its node is made.
+      size_t hash() const {
+        return node->hash;
+      }
+
+      // Number of the node of the formula, unique among the formulas over AP.
+      size_t id() const {
+        return node->id;
+      }
+
       FormulaForm form() const {
-        return formulaForm;
+        return node->form;
       }
 
-      AP getAP() const {
+      AP const& getAP() const {
         if (form() != FormulaForm::Atomic) {
           throw std::domain_error("Attempt to access AP value of non-atomic formula.");
         }
-        return std::get<AP>(children);
+        return *node->ap;
       }
 
-      auto_set<AP> getAPSet() const {
-        return apSet;
-      }
-
-      std::vector<Formula>& getSubformulas() {
-        if (form() == FormulaForm::Atomic) {
-          throw std::domain_error("Attempt to access subformulas of atomic formula.");
-        }
-        return std::get<std::vector<Formula>>(children);
+      auto_set<AP> const& getAPSet() const {
+        return *node->apSet;
       }
 
       std::vector<Formula> const& getSubformulas() const {
         if (form() == FormulaForm::Atomic) {
           throw std::domain_error("Attempt to access subformulas of atomic formula.");
         }
-        return std::get<std::vector<Formula>>(children);
+        return node->children;
       }
 
       friend Formula make_atomic<AP>(AP const&);
@@ -130,30 +165,101 @@ namespace mc {
       friend Formula make_future<AP>(Formula const&);
       friend Formula make_until<AP>(Formula const&, Formula const&);
       friend Formula make_release<AP>(Formula const&, Formula const&);
+      friend class FormulaFactory<AP>;
     private:
-      Formula(AP const& ap)
-        : formulaForm(FormulaForm::Atomic),
-          children(ap),
-          apSet{ap}
+      explicit Formula(_details_::FormulaNode<AP> const* node)
+        : node(node)
         {}
-      Formula(FormulaForm formulaForm, Formula sub)
-        : formulaForm(formulaForm),
-          children(std::vector<Formula>{sub}),
-          apSet(sub.apSet)
-        {}
-      Formula(FormulaForm formulaForm, Formula sub1, Formula sub2)
-        : formulaForm(formulaForm),
-          children(std::vector<Formula>{sub1, sub2}),
-          apSet(sub1.apSet)
-        {
-          for (auto& ap : sub2.apSet) {
-            apSet.insert(ap);
-          }
+
+      _details_::FormulaNode<AP> const* node = nullptr;
+    };
+
+    /**
+     * The unique table behind the formulas over AP. Every distinct formula gets a single node, which lives as long as the program,
+     * as the formulas of a model checking run are few and small next to the automata built from them.
+     * Atomic formulas are told apart with == on AP, so two EqFunctions make the same atomic formula only if they are copies of each other.
+     * Safe to use from several threads at once.
+     */
+    template <typename AP>
+    class FormulaFactory {
+    public:
+      using Node = _details_::FormulaNode<AP>;
+
+      static FormulaFactory& instance() {
+        static FormulaFactory factory;
+        return factory;
+      }
+
+      Node const* atomic(AP const& ap) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = atoms.find(ap);
+        if (iter != atoms.end()) {
+          return iter->second;
+        }
+        size_t hash;
+        if constexpr (traits::hashable<AP>::value) {
+          hash = HashCombine(static_cast<size_t>(FormulaForm::Atomic), Hash<AP>{}(ap));
+        } else {
+          hash = MixHash(nodes.size() + 1);
+        }
+        Node const* node = &nodes.emplace_back(Node{nodes.size() + 1, hash, FormulaForm::Atomic, ap, {}, std::make_shared<auto_set<AP> const>(auto_set<AP>{ap})});
+        atoms.emplace(ap, node);
+        return node;
+      }
+
+      // Makes the node of a formula with the given form and one or two subformulas.
+      Node const* compound(FormulaForm form, std::vector<Formula<AP>> children) {
+        CompoundKey key(form, children[0].id(), children.size() == 2 ? children[1].id() : 0);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = compounds.find(key);
+        if (iter != compounds.end()) {
+          return iter->second;
+        }
+        size_t hash = HashCombine(static_cast<size_t>(form), Hash<std::vector<Formula<AP>>>{}(children));
+        auto apSet = children[0].node->apSet;
+        if (children.size() == 2) {
+          apSet = UnionAPs(apSet, children[1].node->apSet);
         }
+        Node const* node = &nodes.emplace_back(Node{nodes.size() + 1, hash, form, std::nullopt, std::move(children), std::move(apSet)});
+        compounds.emplace(key, node);
+        return node;
+      }
+
+      // Number of distinct formulas made so far.
+      size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nodes.size();
+      }
+
+    private:
+      using CompoundKey = std::tuple<FormulaForm, size_t, size_t>;
+      using APSetPtr = std::shared_ptr<auto_set<AP> const>;
+
+      FormulaFactory() = default;
+
+      // Returns one of the sets if it already holds all of the other's atomic propositions, and their union otherwise.
+      static APSetPtr UnionAPs(APSetPtr const& set1, APSetPtr const& set2) {
+        auto Includes = [](auto_set<AP> const& super, auto_set<AP> const& sub) {
+          return std::all_of(sub.begin(), sub.end(), [&super](AP const& ap) { return super.count(ap) == 1; });
+        };
+        if (set1 == set2 || Includes(*set1, *set2)) {
+          return set1;
+        }
+        if (Includes(*set2, *set1)) {
+          return set2;
+        }
+        auto_set<AP> united = *set1;
+        for (auto const& ap : *set2) {
+          united.insert(ap);
+        }
+        return std::make_shared<auto_set<AP> const>(std::move(united));
+      }
 
-      FormulaForm formulaForm;
-      std::variant<std::vector<Formula>,AP> children;
-      auto_set<AP> apSet;
+      mutable std::mutex mutex;
+      // A deque so that pointers to nodes survive new nodes being made.
+      std::deque<Node> nodes;
+      auto_map<AP, Node const*> atoms;
+      auto_map<CompoundKey, Node const*> compounds;
     };
 
     template <typename T>
@@ -0,0 +1,257 @@
+#ifndef LTL_LAZY_TABLEAU_HH
+#define LTL_LAZY_TABLEAU_HH
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "auto_set.hh"
+#include "auto_map.hh"
+#include "generalized_buchi.hh"
+#include "ltl.hh"
+#include "ltl_to_buchi.hh"
+
+namespace mc {
+  namespace ltl {
+    /**
+     * The GPVW tableau of a normalized formula, built on the fly. A node's successors are only worked out when they are first asked for
+     * and are then kept, so a search of the product with a Kripke structure only pays for the part of the tableau it reaches.
+     * The successors of a node only depend on its next set: they are the nodes its next set expands to, the same nodes LTLToBuchi connects it to.
+     * So the expansion of every next set is kept rather than that of every node.
+     * Nodes are numbered 0, 1, 2, ... in the order they are found, with the same labels and acceptance marks as the nodes of CompiledLTL.
+     * Safe to use from several threads at once, since the parallel searches expand states concurrently.
+     */
+    template <typename AP>
+    class LazyLTL {
+    public:
+      using FormulaSet = auto_set<Formula<AP>>;
+      using NNFAP = std::pair<bool, AP>;
+      using Label = auto_set<NNFAP>;
+
+      // The pseudo node every run starts in. Its successors are the nodes the formula expands to.
+      static constexpr int InitialNode = -1;
+
+      explicit LazyLTL(Formula<AP> const& formula)
+        : initialSet{formula}
+        {
+          FormulaSet seen;
+          CollectUntils(formula, seen);
+        }
+
+      LazyLTL(LazyLTL const&) = delete;
+      LazyLTL& operator=(LazyLTL const&) = delete;
+
+      size_t getNumAcceptanceSets() const {
+        return untils.size();
+      }
+
+      // Calls f(label, next) for each successor next of node, expanding node first if it has not been yet.
+      template <typename F>
+      void forEachSuccessor(int node, F const& f) {
+        Successors const* successors;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          successors = expand(node == InitialNode ? initialSet : nodes[node].nextSet);
+          if (expandedNodes.insert(node).second) {
+            translationStatistics.transitions += successors->size();
+          }
+        }
+        // Found nodes and expansions are never changed or moved, so they can be read without the lock.
+        for (Node const* next : *successors) {
+          f(next->label, next->id);
+        }
+      }
+
+      AcceptanceMarks getMarks(int node) const {
+        if (node == InitialNode) {
+          return AcceptanceMarks();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        return nodes[node].marks;
+      }
+
+      // Number of nodes found so far.
+      size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nodes.size();
+      }
+
+      // How much of the tableau has been built so far, in the terms of the eager construction.
+      TranslationStatistics statistics() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return translationStatistics;
+      }
+
+    private:
+      struct Node {
+        int id;
+        FormulaSet nowSet;
+        FormulaSet nextSet;
+        Label label;
+        AcceptanceMarks marks;
+      };
+      using Successors = std::vector<Node const*>;
+
+      // A node of the expansion whose new set has not been worked through yet.
+      struct Pending {
+        FormulaSet newSet;
+        FormulaSet nowSet;
+        FormulaSet nextSet;
+      };
+
+      // The acceptance sets are those of the until subformulas, which are all known before anything is expanded.
+      void CollectUntils(Formula<AP> const& formula, FormulaSet& seen) {
+        if (!seen.insert(formula).second || formula.form() == FormulaForm::Atomic) {
+          return;
+        }
+        if (formula.form() == FormulaForm::Until) {
+          untils.emplace_back(formula);
+        }
+        for (auto const& sub : formula.getSubformulas()) {
+          CollectUntils(sub, seen);
+        }
+      }
+
+      // Returns the nodes newSet expands to, computing them the first time. Must be called with the lock held.
+      Successors const* expand(FormulaSet const& newSet) {
+        auto iter = expansions.find(newSet);
+        if (iter != expansions.end()) {
+          return iter->second;
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        Successors& successors = successorLists.emplace_back();
+        auto_set<int> found;
+        std::vector<Pending> pending{Pending{newSet, {}, {}}};
+        while (!pending.empty()) {
+          Pending q = std::move(pending.back());
+          pending.pop_back();
+          ++translationStatistics.createdNodes;
+          // Works through the new set as UpdateSplit does, pushing the other side of every split.
+          while (!q.newSet.empty()) {
+            Formula<AP> psi = *q.newSet.begin();
+            q.newSet.erase(q.newSet.begin());
+            q.nowSet.insert(psi);
+            auto sub = [&psi](size_t i) -> Formula<AP> const& {
+              return psi.getSubformulas()[i];
+            };
+            switch (psi.form()) {
+            case FormulaForm::Atomic:
+            case FormulaForm::Not:
+              break;
+
+            case FormulaForm::Or: {
+              Pending split = q;
+              q.newSet.insert(sub(0));
+              split.newSet.insert(sub(1));
+              pending.emplace_back(std::move(split));
+              break;
+            }
+
+            case FormulaForm::And:
+              q.newSet.insert(sub(0));
+              q.newSet.insert(sub(1));
+              break;
+
+            case FormulaForm::Until: {
+              Pending split = q;
+              q.newSet.insert(sub(1));
+              split.newSet.insert(sub(0));
+              split.nextSet.insert(psi);
+              pending.emplace_back(std::move(split));
+              break;
+            }
+
+            case FormulaForm::Release: {
+              Pending split = q;
+              q.newSet.insert(sub(0));
+              q.newSet.insert(sub(1));
+              split.newSet.insert(sub(1));
+              split.nextSet.insert(psi);
+              pending.emplace_back(std::move(split));
+              break;
+            }
+
+            default:
+              std::string formString = (psi.form() == FormulaForm::Global) ? "Global" : "Future";
+              throw std::logic_error("FormulaForm encountered which should never appear in an LTLToBuchi conversion! Formula must be normalized first! Encountered FormulaForm: "+formString);
+            }
+          }
+
+          Node const* node = nodeOf(std::move(q.nowSet), std::move(q.nextSet));
+          if (found.insert(node->id).second) {
+            successors.emplace_back(node);
+          }
+        }
+
+        expansions.emplace(newSet, &successors);
+        translationStatistics.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return &successors;
+      }
+
+      // Returns the node with the given now and next sets, making it if there is none yet. Must be called with the lock held.
+      Node const* nodeOf(FormulaSet nowSet, FormulaSet nextSet) {
+        auto key = std::make_pair(std::move(nowSet), std::move(nextSet));
+        auto iter = nodeIds.find(key);
+        if (iter != nodeIds.end()) {
+          ++translationStatistics.mergedNodes;
+          return &nodes[iter->second];
+        }
+
+        Node node{static_cast<int>(nodes.size()), key.first, key.second, {}, {}};
+        for (auto const& literal : node.nowSet) {
+          if (literal.form() == FormulaForm::Atomic) {
+            node.label.insert(NNFAP(true, literal.getAP()));
+          } else if (literal.form() == FormulaForm::Not) {
+            node.label.insert(NNFAP(false, literal.getSubformulas()[0].getAP()));
+          }
+        }
+        for (size_t c = 0; c < untils.size(); ++c) {
+          // untils[c] is of the form (U a b). The node is in the acceptance set if it satisfies b or does not satisfy (U a b).
+          node.marks.set(c, node.nowSet.count(untils[c].getSubformulas()[1]) == 1 || node.nowSet.count(untils[c]) == 0);
+        }
+        nodeIds.emplace(std::move(key), node.id);
+        ++translationStatistics.tableauNodes;
+        return &nodes.emplace_back(std::move(node));
+      }
+
+      mutable std::mutex mutex;
+      FormulaSet initialSet;
+      std::vector<Formula<AP>> untils;
+      // Deques so that pointers to nodes and successor lists survive new ones being added.
+      std::deque<Node> nodes;
+      std::deque<Successors> successorLists;
+      auto_map<std::pair<FormulaSet, FormulaSet>, int> nodeIds;
+      auto_map<FormulaSet, Successors const*> expansions;
+      // The nodes whose successors have been asked for, so that their transitions are counted once.
+      auto_set<int> expandedNodes;
+      TranslationStatistics translationStatistics;
+    };
+
+    // The same automaton as CompiledToGeneralizedBuchi(CompileLTL(formula)) up to the numbering of its nodes, but built while it is explored.
+    // Returns the automaton along with its tableau, which reports how much of the tableau was built.
+    template <typename AP>
+    auto LazyToGeneralizedBuchi(Formula<AP> const& formula) {
+      using Lazy = LazyLTL<AP>;
+      auto lazy = std::make_shared<Lazy>(formula);
+
+      auto transitions = [lazy](int node, auto const& visit) {
+        lazy->forEachSuccessor(node, visit);
+      };
+
+      auto marks = [lazy](int node) {
+        return lazy->getMarks(node);
+      };
+
+      auto gBuchi = MakeGeneralizedBuchi<int, typename Lazy::Label>({Lazy::InitialNode}, transitions, lazy->getNumAcceptanceSets(), marks);
+      return std::make_pair(gBuchi, std::shared_ptr<Lazy const>(lazy));
+    }
+  }
+}
+
+#endif
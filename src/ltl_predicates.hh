@@ -0,0 +1,258 @@
+#ifndef LTL_PREDICATES_HH
+#define LTL_PREDICATES_HH
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "auto_map.hh"
+#include "ltl.hh"
+#include "ltl_utils.hh"
+
+namespace mc {
+  namespace ltl {
+    /**
+     * A boolean combination of atomic propositions compiled into a flat list of instructions.
+     * Negations are pushed down to the leaves, and && and || become jumps past the rest of an operand once its value is known,
+     * so evaluating a program on a state is one loop that only calls the leaves it needs, instead of a call through
+     * every level of nested closures.
+     */
+    template <typename AP>
+    class PredicateProgram {
+    public:
+      enum class Op : std::uint8_t {
+        // Sets the result to whether leaf operand holds.
+        Test,
+        // Sets the result to whether leaf operand does not hold.
+        TestNot,
+        // Continues at instruction operand if the result is false, and with the next instruction otherwise.
+        JumpIfFalse,
+        // Continues at instruction operand if the result is true, and with the next instruction otherwise.
+        JumpIfTrue
+      };
+
+      struct Instruction {
+        Op op;
+        std::uint32_t operand;
+      };
+
+      template <typename State>
+      bool operator()(State const& state) const {
+        bool result = false;
+        std::uint32_t pc = 0;
+        while (pc < code.size()) {
+          Instruction const& instruction = code[pc];
+          switch (instruction.op) {
+          case Op::Test:
+            result = leaves[instruction.operand](state);
+            break;
+          case Op::TestNot:
+            result = !leaves[instruction.operand](state);
+            break;
+          case Op::JumpIfFalse:
+            if (!result) {
+              pc = instruction.operand;
+              continue;
+            }
+            break;
+          case Op::JumpIfTrue:
+            if (result) {
+              pc = instruction.operand;
+              continue;
+            }
+            break;
+          }
+          ++pc;
+        }
+        return result;
+      }
+
+      // The atomic propositions the program tests, each once.
+      std::vector<AP> leaves;
+      std::vector<Instruction> code;
+    };
+
+    /**
+     * Compresses boolean combinations of atomic propositions into PredicateProgram's instead of closures wrapping closures.
+     * Its notCompressor, orCompressor and andCompressor are meant for Compress (or use the Compress overload taking the compiler).
+     * Every combination is hash consed on the combinations and atomic propositions it is made of, so a combination that appears
+     * more than once in a specification becomes the same atomic proposition each time, and is only tracked once by the translation.
+     * AP must be constructible from a callable taking a state. If AP has setRepresentation, compiled propositions are printed
+     * like the formula they stand for.
+     */
+    template <typename AP>
+    class PredicateCompiler {
+    public:
+      AP compileNot(AP const& ap) {
+        return apOf(nodeOf(Kind::Not, nodeOf(ap), 0));
+      }
+
+      AP compileOr(AP const& ap1, AP const& ap2) {
+        return apOf(nodeOf(Kind::Or, nodeOf(ap1), nodeOf(ap2)));
+      }
+
+      AP compileAnd(AP const& ap1, AP const& ap2) {
+        return apOf(nodeOf(Kind::And, nodeOf(ap1), nodeOf(ap2)));
+      }
+
+      // The compiler must outlive the functions returned below.
+      std::function<AP(AP)> notCompressor() {
+        return [this](AP ap) { return compileNot(ap); };
+      }
+
+      std::function<AP(AP,AP)> orCompressor() {
+        return [this](AP ap1, AP ap2) { return compileOr(ap1, ap2); };
+      }
+
+      std::function<AP(AP,AP)> andCompressor() {
+        return [this](AP ap1, AP ap2) { return compileAnd(ap1, ap2); };
+      }
+
+      // Number of distinct atomic propositions and combinations seen so far.
+      size_t size() const {
+        return nodes.size();
+      }
+
+    private:
+      enum class Kind {
+        Leaf,
+        Not,
+        Or,
+        And
+      };
+
+      // A leaf refers to its atomic proposition, any other node to the nodes of its operands.
+      struct Node {
+        Kind kind;
+        size_t operand1;
+        size_t operand2;
+        std::optional<AP> ap;
+      };
+
+      using Program = PredicateProgram<AP>;
+      using Op = typename Program::Op;
+
+      // The node of ap, which is a leaf unless ap was compiled here.
+      size_t nodeOf(AP const& ap) {
+        auto [iter, inserted] = apNodes.emplace(ap, nodes.size());
+        if (inserted) {
+          nodes.emplace_back(Node{Kind::Leaf, 0, 0, ap});
+        }
+        return iter->second;
+      }
+
+      size_t nodeOf(Kind kind, size_t operand1, size_t operand2) {
+        // (! (! a)) is a itself.
+        if (kind == Kind::Not && nodes[operand1].kind == Kind::Not) {
+          return nodes[operand1].operand1;
+        }
+        auto [iter, inserted] = nodeIds.emplace(std::make_tuple(kind, operand1, operand2), nodes.size());
+        if (inserted) {
+          nodes.emplace_back(Node{kind, operand1, operand2, std::nullopt});
+        }
+        return iter->second;
+      }
+
+      AP apOf(size_t node) {
+        if (nodes[node].ap) {
+          return *nodes[node].ap;
+        }
+        Program program;
+        auto_map<size_t, std::uint32_t> leafIndices;
+        generate(node, false, program, leafIndices);
+        ThreadJumps(program.code);
+        AP ap(std::move(program));
+        if constexpr (_details_::has_set_representation<AP>::value) {
+          ap.setRepresentation(representation(node));
+        }
+        nodes[node].ap = ap;
+        apNodes.emplace(ap, node);
+        return ap;
+      }
+
+      // Appends the code of node, negated if negate is set, to program.
+      void generate(size_t node, bool negate, Program& program, auto_map<size_t, std::uint32_t>& leafIndices) {
+        Node const& n = nodes[node];
+        switch (n.kind) {
+        case Kind::Leaf: {
+          auto [iter, inserted] = leafIndices.emplace(node, static_cast<std::uint32_t>(program.leaves.size()));
+          if (inserted) {
+            program.leaves.emplace_back(*n.ap);
+          }
+          program.code.emplace_back(typename Program::Instruction{negate ? Op::TestNot : Op::Test, iter->second});
+          break;
+        }
+        case Kind::Not:
+          generate(n.operand1, !negate, program, leafIndices);
+          break;
+        case Kind::Or:
+        case Kind::And: {
+          // By De Morgan a negated || is an && of negations and vice versa.
+          bool conjunction = (n.kind == Kind::And) != negate;
+          generate(n.operand1, negate, program, leafIndices);
+          size_t jump = program.code.size();
+          // The second operand only has to be evaluated if the first does not decide the result.
+          program.code.emplace_back(typename Program::Instruction{conjunction ? Op::JumpIfFalse : Op::JumpIfTrue, 0});
+          generate(n.operand2, negate, program, leafIndices);
+          program.code[jump].operand = static_cast<std::uint32_t>(program.code.size());
+          break;
+        }
+        }
+      }
+
+      // Makes jumps that land on other jumps go straight to where those would take them, as the result does not change in between.
+      static void ThreadJumps(std::vector<typename Program::Instruction>& code) {
+        auto IsJump = [](Op op) {
+          return op == Op::JumpIfFalse || op == Op::JumpIfTrue;
+        };
+        for (auto& instruction : code) {
+          if (!IsJump(instruction.op)) {
+            continue;
+          }
+          std::uint32_t target = instruction.operand;
+          while (target < code.size() && IsJump(code[target].op)) {
+            // A jump of the same kind is taken as well, and one of the other kind is not.
+            target = (code[target].op == instruction.op) ? code[target].operand : target + 1;
+          }
+          instruction.operand = target;
+        }
+      }
+
+      std::string representation(size_t node) const {
+        Node const& n = nodes[node];
+        if (n.ap) {
+          std::stringstream stream;
+          stream << *n.ap;
+          return stream.str();
+        }
+        switch (n.kind) {
+        case Kind::Not:
+          return "(! " + representation(n.operand1) + ")";
+        case Kind::Or:
+          return "(|| " + representation(n.operand1) + " " + representation(n.operand2) + ")";
+        case Kind::And:
+          return "(&& " + representation(n.operand1) + " " + representation(n.operand2) + ")";
+        default:
+          return "";
+        }
+      }
+
+      std::vector<Node> nodes;
+      auto_map<AP, size_t> apNodes;
+      auto_map<std::tuple<Kind, size_t, size_t>, size_t> nodeIds;
+    };
+
+    // Compress with the compressors of compiler, so that the compressed atomic propositions are flat programs.
+    template <typename AP>
+    Formula<AP> Compress(Formula<AP> const& formula, PredicateCompiler<AP>& compiler) {
+      return Compress(formula, compiler.notCompressor(), compiler.orCompressor(), compiler.andCompressor());
+    }
+  }
+}
+
+#endif
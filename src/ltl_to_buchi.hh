@@ -1,19 +1,44 @@
 #ifndef LTL_TO_BUCHI_HH
 #define LTL_TO_BUCHI_HH
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <ostream>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 #include "auto_set.hh"
 #include "auto_map.hh"
+#include "hash.hh"
 
 #include "ltl.hh"
 #include "kripke.hh"
 #include "kripke_to_buchi.hh"
+#include "generalized_buchi.hh"
+#include "buchi_reduction.hh"
 
 namespace mc {
   namespace ltl {
+    // Information about how the translation of a formula to an automaton went.
+    struct TranslationStatistics {
+      // Number of nodes the tableau construction made, including those later found to duplicate a finished node.
+      size_t createdNodes = 0;
+      // Number of finished nodes that duplicated an earlier one and were merged into it.
+      size_t mergedNodes = 0;
+      // Number of nodes of the resulting tableau, the states of the automaton (not counting its pseudo initial state).
+      size_t tableauNodes = 0;
+      // Number of transitions of the resulting automaton, including those leaving its pseudo initial state.
+      size_t transitions = 0;
+      // Wall clock time of the tableau construction.
+      double seconds = 0;
+      // The size of the automaton before and after it was reduced, if it was (see ModelCheckOptions::reduce).
+      ReductionStatistics reduction;
+    };
+
     namespace _details_ {
       template <typename AP>
       struct LTLNode {
@@ -42,6 +67,11 @@ namespace mc {
           return !(*this == rhs);
         }
 
+        // Nodes are identified by their id, so that is all that needs to be hashed.
+        size_t hash() const {
+          return std::hash<int>{}(id);
+        }
+
         int id;
         auto_set<Formula<AP>> newSet;
         auto_set<Formula<AP>> nowSet;
@@ -79,29 +109,41 @@ namespace mc {
         std::unordered_map<int, std::unordered_set<int>> outgoing;
       };
 
+      // Hash of the now and next sets of a node, the sets that decide whether two finished nodes are the same.
       template <typename AP>
-      void UpdateClosed(std::unordered_map<int, LTLNode<AP>>& open,
+      size_t NowNextHash(LTLNode<AP> const& node) {
+        return HashCombine(Hash<auto_set<Formula<AP>>>{}(node.nowSet), Hash<auto_set<Formula<AP>>>{}(node.nextSet));
+      }
+
+      // Adds the finished node q to closed, unless a node with the same now and next sets is already closed, in which case q is merged into it.
+      // closedIndex maps NowNextHash of the closed nodes to their ids, so that only nodes with the same hash are compared with q.
+      // Returns whether q was merged.
+      template <typename AP>
+      bool UpdateClosed(std::unordered_map<int, LTLNode<AP>>& open,
                         std::unordered_map<int, LTLNode<AP>>& closed,
+                        auto_map<size_t, std::vector<int>>& closedIndex,
                         NodeRelations& nodeRelations,
                         LTLNode<AP> const& q) {
-        bool foundMatch = false;
-        for (auto& [_,c] : closed) {
+        auto& candidates = closedIndex[NowNextHash(q)];
+        for (int candidateId : candidates) {
+          auto const& c = closed.at(candidateId);
           if (c.nowSet == q.nowSet && c.nextSet == q.nextSet) {
-            foundMatch = true;
             auto qIncoming = nodeRelations.incoming[q.id];
             // Moving transitions a -> q to q -> c
             for (int incomingId : qIncoming) {
               nodeRelations.add_relation(incomingId, c.id);
               nodeRelations.remove_relation(incomingId, q.id);
             }
+            // No two closed nodes have the same sets, so c is the only match.
+            return true;
           }
         }
-        if (!foundMatch) {
-          closed[q.id] = q;
-          auto nextNode = freshNode(q.nextSet, {}, {});
-          nodeRelations.add_relation(q.id, nextNode.id);
-          open[nextNode.id] = nextNode;
-        }
+        closed[q.id] = q;
+        candidates.emplace_back(q.id);
+        auto nextNode = freshNode(q.nextSet, {}, {});
+        nodeRelations.add_relation(q.id, nextNode.id);
+        open[nextNode.id] = nextNode;
+        return false;
       }
 
       template <typename AP>
@@ -169,72 +211,197 @@ namespace mc {
 
     }
 
-    template <typename AP>
-    auto LTLToBuchi(Formula<AP> const& formula) {
-      using Formula = Formula<AP>;
-      using LTLNode = _details_::LTLNode<AP>;
-      using NNFAP = std::pair<bool, AP>;
-      using Kripke = Kripke<LTLNode, NNFAP>;
+    namespace _details_ {
+      // Runs the GPVW tableau construction on a normalized formula.
+      // The resulting graph is returned as a fair Kripke structure whose fairness constraints come from the until subformulas,
+      // along with the set of literals that may label its states.
+      template <typename AP>
+      auto LTLToKripke(Formula<AP> const& formula, TranslationStatistics* statistics = nullptr) {
+        using LTLNode = LTLNode<AP>;
+        using NNFAP = std::pair<bool, AP>;
+        auto start = std::chrono::steady_clock::now();
+        int firstId = LTLNode::count + 1;
+        size_t mergedNodes = 0;
 
-      auto_set<Formula> untilSet{}; // Used for generating the fairness characteristic functions
-      auto_set<NNFAP> nnfSet{};
+        auto_set<Formula<AP>> untilSet{}; // Used for generating the fairness characteristic functions
+        auto_set<NNFAP> nnfSet{};
 
-      std::unordered_map<int, LTLNode> closed{};
-      std::unordered_map<int, LTLNode> open{};
-      _details_::NodeRelations nodeRelations{};
+        std::unordered_map<int, LTLNode> closed{};
+        std::unordered_map<int, LTLNode> open{};
+        auto_map<size_t, std::vector<int>> closedIndex{};
+        NodeRelations nodeRelations{};
 
-      auto firstNode = _details_::freshNode<AP>({formula}, {}, {});
-      open[firstNode.id] = firstNode;
-      nodeRelations.add_relation(-1, firstNode.id);
+        auto firstNode = freshNode<AP>({formula}, {}, {});
+        open[firstNode.id] = firstNode;
+        nodeRelations.add_relation(-1, firstNode.id);
 
-      while (!open.empty()) {
-        LTLNode& q = open.begin()->second;
-        if (q.newSet.empty()) {
-          LTLNode qCopy = q;
-          open.erase(open.begin());
-          _details_::UpdateClosed(open, closed, nodeRelations, qCopy);
-        } else {
-          auto [psiIter,_] = q.nowSet.insert(std::move(*(q.newSet.begin())));
-          q.newSet.erase(q.newSet.begin());
-          _details_::UpdateSplit(open, nodeRelations, untilSet, nnfSet, q, *psiIter);
+        while (!open.empty()) {
+          LTLNode& q = open.begin()->second;
+          if (q.newSet.empty()) {
+            LTLNode qCopy = q;
+            open.erase(open.begin());
+            mergedNodes += UpdateClosed(open, closed, closedIndex, nodeRelations, qCopy);
+          } else {
+            auto [psiIter,_] = q.nowSet.insert(std::move(*(q.newSet.begin())));
+            q.newSet.erase(q.newSet.begin());
+            UpdateSplit(open, nodeRelations, untilSet, nnfSet, q, *psiIter);
+          }
         }
+
+        // The set of initial states are precisely the nodes in closed that contain -1 in their incomingNodes set.
+        auto_set<LTLNode> initStates;
+        for (auto& startId : nodeRelations.outgoing.at(-1)) {
+          LTLNode copy = closed.at(startId);
+          initStates.insert(copy);
+        }
+
+        if (statistics != nullptr) {
+          statistics->createdNodes = static_cast<size_t>(LTLNode::count - firstId + 1);
+          statistics->mergedNodes = mergedNodes;
+          statistics->tableauNodes = closed.size();
+          statistics->transitions = nodeRelations.outgoing.at(-1).size();
+          for (auto const& [id, _] : closed) {
+            statistics->transitions += nodeRelations.outgoing[id].size();
+          }
+          statistics->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::vector<std::function<bool(LTLNode const&)>> fairnessConstraints;
+        for (auto& formula : untilSet) {
+          fairnessConstraints.emplace_back([formula](LTLNode const& q) {
+            // formula is of the form (U a b). q satisfies the constraint if either q satisfies b or does not satisfy (U a b).
+            return (q.nowSet.count(formula.getSubformulas()[1]) == 1) || (q.nowSet.count(formula) == 0);
+          });
+        }
+
+        return std::make_pair(
+          MakeKripke<LTLNode, NNFAP>(
+            initStates,
+            [closed,nodeRelations](LTLNode const& node, auto const& visit) {
+              for (auto nextId : nodeRelations.outgoing.at(node.id)) {
+                visit(closed.at(nextId));
+              }
+            },
+            fairnessConstraints,
+            [](LTLNode const& node, NNFAP const& nnfAP) {
+              auto const& [truth, ap] = nnfAP;
+              for (auto& sub : node.nowSet) {
+                if (sub.form() == FormulaForm::Atomic && sub.getAP() == ap) return truth;
+                if (sub.form() == FormulaForm::Not && sub.getSubformulas()[0].getAP() == ap) return !truth;
+              }
+              return false;
+            }),
+          nnfSet);
       }
+    }
+
+    template <typename AP>
+    auto LTLToBuchi(Formula<AP> const& formula, TranslationStatistics* statistics = nullptr) {
+      auto [kripke, nnfSet] = _details_::LTLToKripke(formula, statistics);
+      return KripkeToBuchi(kripke, nnfSet);
+    }
 
-      // The set of initial states are precisely the nodes in closed that contain -1 in their incomingNodes set.
-      auto_set<LTLNode> initStates;
-      for (auto& startId : nodeRelations.outgoing.at(-1)) {
-        LTLNode copy = closed.at(startId);
-        initStates.insert(copy);
+    // Same as LTLToBuchi except the fairness of every until subformula is kept as its own acceptance set instead of being degeneralized with a counter.
+    template <typename AP>
+    auto LTLToGeneralizedBuchi(Formula<AP> const& formula, TranslationStatistics* statistics = nullptr) {
+      auto [kripke, nnfSet] = _details_::LTLToKripke(formula, statistics);
+      return KripkeToGeneralizedBuchi(kripke, nnfSet);
+    }
+
+    // The tableau of a formula in a compact form made for fast exploration.
+    // Nodes are numbered 0..n-1, edges are stored in flat arrays and the label and acceptance marks of every node are computed once up front.
+    // The tableau nodes themselves, with their formula sets, are only kept in a side table for diagnostics.
+    template <typename AP>
+    struct CompiledLTL {
+      using NNFAP = std::pair<bool, AP>;
+      using Label = auto_set<NNFAP>;
+
+      // The pseudo node every run starts in. Its successors are the initial nodes.
+      static constexpr int InitialNode = -1;
+
+      size_t size() const {
+        return labels.size();
       }
 
-      std::vector<typename Kripke::StateCharFunc> fairnessConstraints;
-      for (auto& formula : untilSet) {
-        fairnessConstraints.emplace_back([formula](LTLNode const& q) {
-          // formula is of the form (U a b). q satisfies the constraint if either q satisfies b or does not satisfy (U a b).
-          return (q.nowSet.count(formula.getSubformulas()[1]) == 1) || (q.nowSet.count(formula) == 0);
+      std::vector<int> initialNodes;
+      // The successors of node i are edgeTargets[edgeOffsets[i]] up to (not including) edgeTargets[edgeOffsets[i+1]].
+      std::vector<size_t> edgeOffsets;
+      std::vector<int> edgeTargets;
+      // The literals that hold in each node.
+      std::vector<Label> labels;
+      // The acceptance sets each node is in, one set per until subformula.
+      std::vector<AcceptanceMarks> marks;
+      size_t numAcceptanceSets = 0;
+      // Every literal that may appear in a label.
+      auto_set<NNFAP> literals;
+      // The tableau node each node was compiled from. Empty if the automaton was not built by the tableau construction (see CompileVWAA).
+      std::vector<_details_::LTLNode<AP>> nodes;
+    };
+
+    template <typename AP>
+    CompiledLTL<AP> CompileLTL(Formula<AP> const& formula, TranslationStatistics* statistics = nullptr) {
+      auto [kripke, nnfSet] = _details_::LTLToKripke(formula, statistics);
+
+      CompiledLTL<AP> compiled;
+      compiled.numAcceptanceSets = kripke.getNumConstraints();
+      compiled.literals = nnfSet;
+
+      // Maps the id of a tableau node to its index, numbering nodes in the order they are discovered.
+      std::unordered_map<int, int> nodeIndex;
+      auto IndexOf = [&](_details_::LTLNode<AP> const& node) {
+        auto [iter, inserted] = nodeIndex.emplace(node.id, static_cast<int>(compiled.nodes.size()));
+        if (inserted) {
+          compiled.nodes.emplace_back(node);
+        }
+        return iter->second;
+      };
+
+      for (auto const& init : kripke.getInitialStates()) {
+        compiled.initialNodes.emplace_back(IndexOf(init));
+      }
+      // compiled.nodes grows while it is being walked, which makes this a breadth first search over the tableau.
+      for (size_t i = 0; i < compiled.nodes.size(); ++i) {
+        auto node = compiled.nodes[i];
+        compiled.edgeOffsets.emplace_back(compiled.edgeTargets.size());
+        kripke.forEachSuccessor(node, [&](_details_::LTLNode<AP> const& next) {
+          compiled.edgeTargets.emplace_back(IndexOf(next));
         });
+        compiled.labels.emplace_back(kripke.getAPSubset(node, nnfSet));
+        AcceptanceMarks nodeMarks;
+        for (size_t c = 0; c < kripke.getNumConstraints(); ++c) {
+          nodeMarks.set(c, kripke.checkConstraint(c, node));
+        }
+        compiled.marks.emplace_back(nodeMarks);
       }
+      compiled.edgeOffsets.emplace_back(compiled.edgeTargets.size());
+      return compiled;
+    }
 
-      return KripkeToBuchi(
-        Kripke(
-          initStates,
-          [closed,nodeRelations](LTLNode const& node) {
-            auto_set<LTLNode> nextSet;
-            for (auto nextId : nodeRelations.outgoing.at(node.id)) {
-              nextSet.insert(closed.at(nextId));
-            }
-            return nextSet;
-          },
-          fairnessConstraints,
-          [](LTLNode const& node, NNFAP const& nnfAP) {
-            auto const& [truth, ap] = nnfAP;
-            for (auto& sub : node.nowSet) {
-              if (sub.form() == FormulaForm::Atomic && sub.getAP() == ap) return truth;
-              if (sub.form() == FormulaForm::Not && sub.getSubformulas()[0].getAP() == ap) return !truth;
-            }
-            return false;
-          }),
-        nnfSet);
+    // The same automaton as LTLToGeneralizedBuchi, but its states are the node numbers of the compiled tableau (and InitialNode).
+    // Expanding a state only reads the flat arrays of the compiled tableau rather than copying tableau nodes.
+    template <typename AP>
+    auto CompiledToGeneralizedBuchi(CompiledLTL<AP> const& compiledLTL) {
+      using Compiled = CompiledLTL<AP>;
+      // Shared so that copies of the automaton (e.g. those captured by Intersection) do not copy the arrays.
+      auto compiled = std::make_shared<Compiled const>(compiledLTL);
+
+      auto transitions = [compiled](int node, auto const& visit) {
+        auto VisitNext = [&](int next) {
+          visit(compiled->labels[next], next);
+        };
+        if (node == Compiled::InitialNode) {
+          std::for_each(compiled->initialNodes.begin(), compiled->initialNodes.end(), VisitNext);
+        } else {
+          std::for_each(compiled->edgeTargets.begin() + compiled->edgeOffsets[node],
+                        compiled->edgeTargets.begin() + compiled->edgeOffsets[node + 1], VisitNext);
+        }
+      };
+
+      auto marks = [compiled](int node) {
+        return (node == Compiled::InitialNode) ? AcceptanceMarks() : compiled->marks[node];
+      };
+
+      return MakeGeneralizedBuchi<int, typename Compiled::Label>({Compiled::InitialNode}, transitions, compiled->numAcceptanceSets, marks);
     }
   }
 }
@@ -0,0 +1,385 @@
+#ifndef LTL_TO_VWAA_HH
+#define LTL_TO_VWAA_HH
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "auto_set.hh"
+#include "auto_map.hh"
+#include "generalized_buchi.hh"
+#include "ltl.hh"
+#include "ltl_to_buchi.hh"
+
+namespace mc {
+  namespace ltl {
+    /**
+     * The very weak alternating automaton of a normalized formula, as in Gastin and Oddoux's LTL2BA.
+     * Its states are the until and release subformulas. A transition reads a conjunction of literals and moves to a set of states,
+     * every one of which has to accept the rest of the word. Transitions from the formula itself are kept in initialTransitions,
+     * so the formula need not be a state.
+     * A run is rejected if one of its branches stays in an until state forever.
+     */
+    template <typename AP>
+    struct VWAA {
+      using NNFAP = std::pair<bool, AP>;
+      using Label = auto_set<NNFAP>;
+      // A sorted set of states, which all have to accept.
+      using Configuration = std::vector<int>;
+
+      struct Transition {
+        Label label;
+        Configuration next;
+      };
+
+      size_t size() const {
+        return states.size();
+      }
+
+      // The subformula each state stands for.
+      std::vector<Formula<AP>> states;
+      std::vector<std::vector<Transition>> transitions;
+      std::vector<Transition> initialTransitions;
+      // The until states, in the order of the acceptance sets they give rise to.
+      std::vector<int> untilStates;
+    };
+
+    namespace _details_ {
+      template <typename AP>
+      bool Includes(auto_set<std::pair<bool, AP>> const& super, auto_set<std::pair<bool, AP>> const& sub) {
+        return std::all_of(sub.begin(), sub.end(), [&super](auto const& literal) { return super.count(literal) == 1; });
+      }
+
+      // Whether the label requires some atomic proposition to be both true and false.
+      template <typename AP>
+      bool Contradictory(auto_set<std::pair<bool, AP>> const& label) {
+        return std::any_of(label.begin(), label.end(), [&label](auto const& literal) {
+          return label.count(std::make_pair(!literal.first, literal.second)) == 1;
+        });
+      }
+
+      // Removes the transitions that another transition makes redundant, because it asks for no more literals, moves to no more states
+      // and is in at least the same acceptance sets. Of equal transitions the first is kept.
+      // marks(i) gives the acceptance sets of transitions[i].
+      template <typename Transition, typename Marks>
+      std::vector<size_t> Undominated(std::vector<Transition> const& transitions, Marks const& marks) {
+        auto Dominates = [&](size_t i, size_t j) {
+          return Includes(transitions[j].label, transitions[i].label)
+            && std::includes(transitions[j].next.begin(), transitions[j].next.end(), transitions[i].next.begin(), transitions[i].next.end())
+            && (marks(i) & marks(j)) == marks(j);
+        };
+        std::vector<size_t> kept;
+        for (size_t j = 0; j < transitions.size(); ++j) {
+          bool dominated = false;
+          for (size_t i = 0; i < transitions.size() && !dominated; ++i) {
+            // An equal transition only counts as dominating if it comes first.
+            dominated = (i != j) && Dominates(i, j) && (i < j || !Dominates(j, i));
+          }
+          if (!dominated) {
+            kept.emplace_back(j);
+          }
+        }
+        return kept;
+      }
+
+      // Builds the VWAA of a normalized formula, working out the transitions of a subformula once however often it appears.
+      template <typename AP>
+      class VWAABuilder {
+      public:
+        using Automaton = VWAA<AP>;
+        using Transition = typename Automaton::Transition;
+        using Transitions = std::vector<Transition>;
+
+        Automaton build(Formula<AP> const& formula) {
+          automaton.initialTransitions = delta(formula);
+          // Every state was found, and its transitions worked out, while expanding the formula.
+          for (auto const& state : automaton.states) {
+            automaton.transitions.emplace_back(delta(state));
+          }
+          return std::move(automaton);
+        }
+
+        // The conjunction of two sets of transitions: one transition for each pair whose labels agree.
+        static Transitions Product(Transitions const& lhs, Transitions const& rhs) {
+          Transitions product;
+          for (auto const& t1 : lhs) {
+            for (auto const& t2 : rhs) {
+              Transition t{t1.label, {}};
+              for (auto const& literal : t2.label) {
+                t.label.insert(literal);
+              }
+              if (Contradictory(t.label)) {
+                continue;
+              }
+              std::set_union(t1.next.begin(), t1.next.end(), t2.next.begin(), t2.next.end(), std::back_inserter(t.next));
+              product.emplace_back(std::move(t));
+            }
+          }
+          return Simplify(std::move(product));
+        }
+
+        static Transitions Simplify(Transitions transitions) {
+          Transitions simplified;
+          for (size_t i : Undominated(transitions, [](size_t) { return AcceptanceMarks(); })) {
+            simplified.emplace_back(std::move(transitions[i]));
+          }
+          return simplified;
+        }
+
+      private:
+        int stateOf(Formula<AP> const& formula) {
+          auto [iter, inserted] = stateIds.emplace(formula, static_cast<int>(automaton.states.size()));
+          if (inserted) {
+            automaton.states.emplace_back(formula);
+            if (formula.form() == FormulaForm::Until) {
+              automaton.untilStates.emplace_back(iter->second);
+            }
+          }
+          return iter->second;
+        }
+
+        Transitions const& delta(Formula<AP> const& formula) {
+          auto iter = deltas.find(formula);
+          if (iter != deltas.end()) {
+            return iter->second;
+          }
+          auto sub = [&formula](size_t i) -> Formula<AP> const& {
+            return formula.getSubformulas()[i];
+          };
+          Transitions transitions;
+          switch (formula.form()) {
+          case FormulaForm::Atomic:
+            transitions.emplace_back(Transition{{std::make_pair(true, formula.getAP())}, {}});
+            break;
+
+          case FormulaForm::Not:
+            transitions.emplace_back(Transition{{std::make_pair(false, sub(0).getAP())}, {}});
+            break;
+
+          case FormulaForm::And:
+            transitions = Product(delta(sub(0)), delta(sub(1)));
+            break;
+
+          case FormulaForm::Or: {
+            transitions = delta(sub(0));
+            auto const& right = delta(sub(1));
+            transitions.insert(transitions.end(), right.begin(), right.end());
+            transitions = Simplify(std::move(transitions));
+            break;
+          }
+
+          case FormulaForm::Until: {
+            // (U a b) either holds through b now, or through a now and (U a b) again later.
+            Transitions stay{Transition{{}, {stateOf(formula)}}};
+            transitions = delta(sub(1));
+            auto later = Product(delta(sub(0)), stay);
+            transitions.insert(transitions.end(), later.begin(), later.end());
+            transitions = Simplify(std::move(transitions));
+            break;
+          }
+
+          case FormulaForm::Release: {
+            // (R a b) needs b now, and either a now or (R a b) again later.
+            Transitions stay{Transition{{}, {stateOf(formula)}}};
+            auto released = delta(sub(0));
+            released.insert(released.end(), stay.begin(), stay.end());
+            transitions = Product(delta(sub(1)), Simplify(std::move(released)));
+            break;
+          }
+
+          default:
+            std::string formString = (formula.form() == FormulaForm::Global) ? "Global" : "Future";
+            throw std::logic_error("FormulaForm encountered which should never appear in a VWAA conversion! Formula must be normalized first! Encountered FormulaForm: "+formString);
+          }
+          return deltas.emplace(formula, std::move(transitions)).first->second;
+        }
+
+        Automaton automaton;
+        auto_map<Formula<AP>, int> stateIds;
+        auto_map<Formula<AP>, Transitions> deltas;
+      };
+    }
+
+    template <typename AP>
+    VWAA<AP> LTLToVWAA(Formula<AP> const& formula) {
+      return _details_::VWAABuilder<AP>().build(formula);
+    }
+
+    /**
+     * Translates a normalized formula the way LTL2BA does: to a VWAA, then to a generalized Buchi automaton whose states are
+     * configurations of the VWAA, simplifying both along the way. The result is compiled like the tableau (see CompileLTL),
+     * so it can stand in for it anywhere, though its nodes were not tableau nodes and CompiledLTL::nodes is left empty.
+     *
+     * The generalized automaton has one acceptance set per until state u, made of the transitions that do not keep u waiting.
+     * Labels and acceptance sets belong to transitions here, while CompiledLTL puts them on nodes, so every node stands for a transition:
+     * the label it was entered by, the configuration it moved to and the acceptance sets of the move.
+     * Transitions of a configuration that are dominated by another are dropped, then nodes that cannot be told apart by their labels,
+     * acceptance sets and successors are merged, and finally acceptance sets every node is in are dropped.
+     * statistics counts the nodes before merging as created and reports the difference as merged.
+     */
+    template <typename AP>
+    CompiledLTL<AP> CompileVWAA(Formula<AP> const& formula, TranslationStatistics* statistics = nullptr) {
+      using Automaton = VWAA<AP>;
+      using Configuration = typename Automaton::Configuration;
+      using Transition = typename Automaton::Transition;
+      using Label = typename Automaton::Label;
+      using Builder = _details_::VWAABuilder<AP>;
+      auto start = std::chrono::steady_clock::now();
+
+      Automaton vwaa = LTLToVWAA(formula);
+      size_t numUntils = vwaa.untilStates.size();
+
+      // Transition t, leaving a configuration, is in the acceptance set of until state u
+      // if it does not move to u, or if it could have been taken with one of u's own transitions that leaves u.
+      auto MarksOf = [&vwaa, numUntils](Transition const& t) {
+        AcceptanceMarks marks;
+        for (size_t c = 0; c < numUntils; ++c) {
+          int u = vwaa.untilStates[c];
+          auto const& uTransitions = vwaa.transitions[u];
+          marks.set(c, !std::binary_search(t.next.begin(), t.next.end(), u)
+                    || std::any_of(uTransitions.begin(), uTransitions.end(), [&](Transition const& ut) {
+                         return !std::binary_search(ut.next.begin(), ut.next.end(), u) && _details_::Includes(t.label, ut.label)
+                           && std::includes(t.next.begin(), t.next.end(), ut.next.begin(), ut.next.end());
+                       }));
+        }
+        return marks;
+      };
+
+      // The nodes of the generalized automaton, found breadth first.
+      using NodeKey = std::tuple<Label, Configuration, unsigned long long>;
+      std::vector<NodeKey> nodes;
+      auto_map<NodeKey, int> nodeIds;
+      auto NodesOf = [&](std::vector<Transition> const& transitions) {
+        std::vector<AcceptanceMarks> marks;
+        for (auto const& t : transitions) {
+          marks.emplace_back(MarksOf(t));
+        }
+        std::vector<int> successors;
+        for (size_t i : _details_::Undominated(transitions, [&marks](size_t i) { return marks[i]; })) {
+          NodeKey key(transitions[i].label, transitions[i].next, marks[i].to_ullong());
+          auto [iter, inserted] = nodeIds.emplace(key, static_cast<int>(nodes.size()));
+          if (inserted) {
+            nodes.emplace_back(std::move(key));
+          }
+          successors.emplace_back(iter->second);
+        }
+        return successors;
+      };
+
+      // Nodes moving to the same configuration have the same successors, so they are worked out once per configuration.
+      auto_map<Configuration, std::vector<int>> configurationSuccessors;
+      std::vector<int> initialNodes = NodesOf(vwaa.initialTransitions);
+      std::vector<std::vector<int>> successors;
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        Configuration configuration = std::get<1>(nodes[i]);
+        auto iter = configurationSuccessors.find(configuration);
+        if (iter == configurationSuccessors.end()) {
+          // The conjunction of the transitions of every state of the configuration. The empty configuration accepts anything.
+          std::vector<Transition> transitions{Transition{{}, {}}};
+          for (int state : configuration) {
+            transitions = Builder::Product(transitions, vwaa.transitions[state]);
+          }
+          iter = configurationSuccessors.emplace(configuration, NodesOf(transitions)).first;
+        }
+        successors.emplace_back(iter->second);
+      }
+
+      // Merges nodes that have the same label and acceptance sets and whose successors are in the same blocks, until no block splits.
+      std::vector<size_t> block(nodes.size());
+      size_t numBlocks = 0;
+      {
+        auto_map<std::pair<Label, unsigned long long>, size_t> blockIds;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          block[i] = blockIds.emplace(std::make_pair(std::get<0>(nodes[i]), std::get<2>(nodes[i])), blockIds.size()).first->second;
+        }
+        numBlocks = blockIds.size();
+      }
+      auto SuccessorBlocks = [&](std::vector<int> const& next) {
+        std::vector<size_t> blocks;
+        for (int n : next) {
+          blocks.emplace_back(block[n]);
+        }
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+        return blocks;
+      };
+      while (true) {
+        auto_map<std::pair<size_t, std::vector<size_t>>, size_t> blockIds;
+        std::vector<size_t> refined(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          refined[i] = blockIds.emplace(std::make_pair(block[i], SuccessorBlocks(successors[i])), blockIds.size()).first->second;
+        }
+        block = std::move(refined);
+        if (blockIds.size() == numBlocks) {
+          break;
+        }
+        numBlocks = blockIds.size();
+      }
+
+      // An acceptance set every node is in does not constrain the runs.
+      AcceptanceMarks everywhere;
+      for (size_t c = 0; c < numUntils; ++c) {
+        everywhere.set(c);
+      }
+      for (auto const& node : nodes) {
+        everywhere &= AcceptanceMarks(std::get<2>(node));
+      }
+
+      CompiledLTL<AP> compiled;
+      for (size_t c = 0; c < numUntils; ++c) {
+        compiled.numAcceptanceSets += !everywhere.test(c);
+      }
+      // The node of each block that stands for it, the first one found.
+      std::vector<int> representative(numBlocks, -1);
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        if (representative[block[i]] == -1) {
+          representative[block[i]] = static_cast<int>(i);
+        }
+      }
+      for (size_t b : SuccessorBlocks(initialNodes)) {
+        compiled.initialNodes.emplace_back(static_cast<int>(b));
+      }
+      for (size_t b = 0; b < numBlocks; ++b) {
+        auto const& [label, configuration, marks] = nodes[representative[b]];
+        compiled.edgeOffsets.emplace_back(compiled.edgeTargets.size());
+        for (size_t next : SuccessorBlocks(successors[representative[b]])) {
+          compiled.edgeTargets.emplace_back(static_cast<int>(next));
+        }
+        compiled.labels.emplace_back(label);
+        for (auto const& literal : label) {
+          compiled.literals.insert(literal);
+        }
+        AcceptanceMarks nodeMarks;
+        AcceptanceMarks untilMarks(marks);
+        for (size_t c = 0, kept = 0; c < numUntils; ++c) {
+          if (!everywhere.test(c)) {
+            nodeMarks.set(kept++, untilMarks.test(c));
+          }
+        }
+        compiled.marks.emplace_back(nodeMarks);
+      }
+      compiled.edgeOffsets.emplace_back(compiled.edgeTargets.size());
+
+      if (statistics != nullptr) {
+        statistics->createdNodes = nodes.size();
+        statistics->mergedNodes = nodes.size() - numBlocks;
+        statistics->tableauNodes = numBlocks;
+        statistics->transitions = compiled.initialNodes.size() + compiled.edgeTargets.size();
+        statistics->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+      return compiled;
+    }
+
+    // The Buchi automaton CompileVWAA translates a normalized formula to, degeneralized. See LTLToBuchi.
+    template <typename AP>
+    auto VWAAToBuchi(Formula<AP> const& formula, TranslationStatistics* statistics = nullptr) {
+      return Degeneralize(CompiledToGeneralizedBuchi(CompileVWAA(formula, statistics)));
+    }
+  }
+}
+
+#endif
@@ -2,81 +2,438 @@
 #define LTL_UTILS_HH
 
 #include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
 
+#include "auto_map.hh"
 #include "ltl.hh"
 
 namespace mc {
   namespace ltl {
-    // Puts formula into NNF and removes G's and F's using equivalences to R and U
+    namespace _details_ {
+      template <typename AP, typename = void>
+      struct has_set_representation : std::false_type {};
+      template <typename AP>
+      struct has_set_representation<AP, std::void_t<decltype(std::declval<AP&>().setRepresentation(std::string()))>> : std::true_type {};
+
+      template <typename AP>
+      AP MakeConstant(bool value) {
+        AP constant([value](auto const&) { return value; });
+        if constexpr (has_set_representation<AP>::value) {
+          constant.setRepresentation(value ? "true" : "false");
+        }
+        return constant;
+      }
+    }
+
+    // The atomic proposition that always holds. Every call returns the same one, so the true atoms of different formulas are one atom.
     template <typename AP>
-    Formula<AP> Normalize(Formula<AP> const& formula,
-                          AP const& trueAP = [](auto const&) { return true; },
-                          AP const& falseAP = [](auto const&) { return false; }) {
-      auto True = make_atomic<AP>(trueAP);
-      auto False = make_atomic<AP>(falseAP);
+    AP const& TrueAP() {
+      static AP const trueAP = _details_::MakeConstant<AP>(true);
+      return trueAP;
+    }
 
-      switch(formula.form()) {
-      case FormulaForm::Atomic:
-        return formula;
+    // The atomic proposition that never holds. See TrueAP.
+    template <typename AP>
+    AP const& FalseAP() {
+      static AP const falseAP = _details_::MakeConstant<AP>(false);
+      return falseAP;
+    }
 
-      case FormulaForm::Until:
-        return make_until(Normalize(formula.getSubformulas()[0], trueAP, falseAP),
-                          Normalize(formula.getSubformulas()[1], trueAP, falseAP));
+    namespace _details_ {
+      // Normalizes formulas, negated or not, remembering the result for every subformula so that shared subformulas are normalized once.
+      template <typename AP>
+      class Normalizer {
+      public:
+        Normalizer(AP const& trueAP, AP const& falseAP)
+          : True(make_atomic<AP>(trueAP)),
+            False(make_atomic<AP>(falseAP))
+          {}
 
-      case FormulaForm::Release:
-        return make_release(Normalize(formula.getSubformulas()[0], trueAP, falseAP),
-                            Normalize(formula.getSubformulas()[1], trueAP, falseAP));
+        Formula<AP> operator()(Formula<AP> const& formula, bool negate) {
+          auto key = std::make_pair(formula, negate);
+          auto iter = normalized.find(key);
+          if (iter != normalized.end()) {
+            return iter->second;
+          }
+          Formula<AP> result = normalize(formula, negate);
+          normalized.emplace(std::move(key), result);
+          return result;
+        }
 
-      case FormulaForm::Global:
-        // (G f) = (R false f)
-        return make_release(False, Normalize(formula.getSubformulas()[0], trueAP, falseAP));
+      private:
+        Formula<AP> normalize(Formula<AP> const& formula, bool negate) {
+          auto sub = [&](size_t i, bool negateSub) {
+            return (*this)(formula.getSubformulas()[i], negateSub);
+          };
+          switch (formula.form()) {
+          case FormulaForm::Atomic:
+            if (formula == True || formula == False) {
+              return ((formula == True) != negate) ? True : False;
+            }
+            return negate ? make_not(formula) : formula;
 
-      case FormulaForm::Future:
-        // (F f) = (U true f)
-        return make_until(True, Normalize(formula.getSubformulas()[0], trueAP, falseAP));
+          case FormulaForm::Not:
+            return sub(0, !negate);
 
-      case FormulaForm::Or:
-        return make_or(Normalize(formula.getSubformulas()[0], trueAP, falseAP),
-                       Normalize(formula.getSubformulas()[1], trueAP, falseAP));
+          case FormulaForm::And:
+            // (! (&& f g)) = (|| (! f) (! g))
+            return negate ? makeOr(sub(0, true), sub(1, true)) : makeAnd(sub(0, false), sub(1, false));
 
-      case FormulaForm::And:
-        return make_and(Normalize(formula.getSubformulas()[0], trueAP, falseAP),
-                        Normalize(formula.getSubformulas()[1], trueAP, falseAP));
+          case FormulaForm::Or:
+            // (! (|| f g)) = (&& (! f) (! g))
+            return negate ? makeAnd(sub(0, true), sub(1, true)) : makeOr(sub(0, false), sub(1, false));
 
-      case FormulaForm::Not:
-        auto sub = formula.getSubformulas()[0];
+          case FormulaForm::Until:
+            // (! (U f g)) = (R (! f) (! g))
+            return negate ? makeRelease(sub(0, true), sub(1, true)) : makeUntil(sub(0, false), sub(1, false));
 
-        switch (sub.form()) {
-        case FormulaForm::Atomic:
+          case FormulaForm::Release:
+            // (! (R f g)) = (U (! f) (! g))
+            return negate ? makeUntil(sub(0, true), sub(1, true)) : makeRelease(sub(0, false), sub(1, false));
+
+          case FormulaForm::Global:
+            // (G f) = (R false f) and (! (G f)) = (F (! f)) = (U true (! f))
+            return negate ? makeUntil(True, sub(0, true)) : makeRelease(False, sub(0, false));
+
+          case FormulaForm::Future:
+            // (F f) = (U true f) and (! (F f)) = (G (! f)) = (R false (! f))
+            return negate ? makeRelease(False, sub(0, true)) : makeUntil(True, sub(0, false));
+          }
           return formula;
+        }
+
+        // The make functions fold away the constants wherever they decide the result.
+        Formula<AP> makeAnd(Formula<AP> const& f, Formula<AP> const& g) const {
+          if (f == False || g == False) return False;
+          if (f == True) return g;
+          if (g == True) return f;
+          return make_and(f, g);
+        }
+
+        Formula<AP> makeOr(Formula<AP> const& f, Formula<AP> const& g) const {
+          if (f == True || g == True) return True;
+          if (f == False) return g;
+          if (g == False) return f;
+          return make_or(f, g);
+        }
+
+        Formula<AP> makeUntil(Formula<AP> const& f, Formula<AP> const& g) const {
+          // (U f true) = true, (U f false) = false and (U false g) = g
+          if (g == True || g == False || f == False) return g;
+          return make_until(f, g);
+        }
+
+        Formula<AP> makeRelease(Formula<AP> const& f, Formula<AP> const& g) const {
+          // (R f true) = true, (R f false) = false and (R true g) = g
+          if (g == True || g == False || f == True) return g;
+          return make_release(f, g);
+        }
+
+        Formula<AP> True;
+        Formula<AP> False;
+        auto_map<std::pair<Formula<AP>, bool>, Formula<AP>> normalized;
+      };
+    }
 
+    // Puts formula into NNF and removes G's and F's using equivalences to R and U.
+    // trueAP and falseAP stand for the constants. Wherever a constant decides the value of an operator it is folded away,
+    // so the result has no more atomic propositions than it needs. Leaving them out uses the canonical TrueAP and FalseAP,
+    // so that the constants of every normalized formula are the same atoms.
+    template <typename AP>
+    Formula<AP> Normalize(Formula<AP> const& formula, AP const& trueAP = TrueAP<AP>(), AP const& falseAP = FalseAP<AP>()) {
+      return _details_::Normalizer<AP>(trueAP, falseAP)(formula, false);
+    }
+
+    // Number of atomic propositions and operators in formula, counting a shared subformula every time it appears.
+    template <typename AP>
+    size_t FormulaSize(Formula<AP> const& formula) {
+      auto_map<Formula<AP>, size_t> sizes;
+      std::function<size_t(Formula<AP> const&)> Size = [&sizes, &Size](Formula<AP> const& f) -> size_t {
+        if (f.form() == FormulaForm::Atomic) {
+          return 1;
+        }
+        auto iter = sizes.find(f);
+        if (iter != sizes.end()) {
+          return iter->second;
+        }
+        size_t size = 1;
+        for (auto const& sub : f.getSubformulas()) {
+          size += Size(sub);
+        }
+        sizes.emplace(f, size);
+        return size;
+      };
+      return Size(formula);
+    }
+
+    namespace _details_ {
+      // Puts formula, negated if negate is set, into negation normal form. See NegationNormalForm.
+      template <typename AP>
+      Formula<AP> PushNegations(Formula<AP> const& formula, bool negate) {
+        auto sub = [&formula](size_t i) -> Formula<AP> const& {
+          return formula.getSubformulas()[i];
+        };
+        switch (formula.form()) {
+        case FormulaForm::Atomic:
+          return negate ? make_not(formula) : formula;
+        case FormulaForm::Not:
+          return PushNegations(sub(0), !negate);
+        case FormulaForm::And:
+        case FormulaForm::Or: {
+          bool conjunction = (formula.form() == FormulaForm::And) != negate;
+          auto left = PushNegations(sub(0), negate);
+          auto right = PushNegations(sub(1), negate);
+          return conjunction ? make_and(left, right) : make_or(left, right);
+        }
+        case FormulaForm::Global:
+        case FormulaForm::Future: {
+          bool global = (formula.form() == FormulaForm::Global) != negate;
+          auto body = PushNegations(sub(0), negate);
+          return global ? make_global(body) : make_future(body);
+        }
         case FormulaForm::Until:
-          return make_release(Normalize(make_not(sub.getSubformulas()[0]), trueAP, falseAP),
-                              Normalize(make_not(sub.getSubformulas()[1]), trueAP, falseAP));
+        case FormulaForm::Release: {
+          bool until = (formula.form() == FormulaForm::Until) != negate;
+          auto left = PushNegations(sub(0), negate);
+          auto right = PushNegations(sub(1), negate);
+          return until ? make_until(left, right) : make_release(left, right);
+        }
+        }
+        return formula;
+      }
 
+    }
+
+    // Pushes the negations of formula down to its atomic propositions. Unlike Normalize, this keeps the G's and F's.
+    template <typename AP>
+    Formula<AP> NegationNormalForm(Formula<AP> const& formula) {
+      return _details_::PushNegations(formula, false);
+    }
+
+    namespace _details_ {
+      // A syntactic check that every word satisfying f satisfies g. May miss implications, but never claims a false one.
+      template <typename AP>
+      bool Implies(Formula<AP> const& f, Formula<AP> const& g) {
+        if (f == g) {
+          return true;
+        }
+        auto Is = [](Formula<AP> const& formula, FormulaForm form) {
+          return formula.form() == form;
+        };
+        auto Sub = [](Formula<AP> const& formula, size_t i) -> Formula<AP> const& {
+          return formula.getSubformulas()[i];
+        };
+
+        switch (g.form()) {
+        case FormulaForm::Or:
+          if (Implies(f, Sub(g, 0)) || Implies(f, Sub(g, 1))) {
+            return true;
+          }
+          break;
+        case FormulaForm::And:
+          if (Implies(f, Sub(g, 0)) && Implies(f, Sub(g, 1))) {
+            return true;
+          }
+          break;
+        case FormulaForm::Until:
+          // (U c d) holds whenever d does.
+          if (Implies(f, Sub(g, 1)) || (Is(f, FormulaForm::Until) && Implies(Sub(f, 0), Sub(g, 0)) && Implies(Sub(f, 1), Sub(g, 1)))) {
+            return true;
+          }
+          break;
+        case FormulaForm::Future:
+          if (Implies(f, Sub(g, 0))
+              || ((Is(f, FormulaForm::Future) || Is(f, FormulaForm::Until)) && Implies(Sub(f, Is(f, FormulaForm::Until) ? 1 : 0), Sub(g, 0)))) {
+            return true;
+          }
+          break;
         case FormulaForm::Release:
-          return make_until(Normalize(make_not(sub.getSubformulas()[0]), trueAP, falseAP),
-                            Normalize(make_not(sub.getSubformulas()[1]), trueAP, falseAP));
+          // (R c d) holds whenever c and d both do, or d holds forever.
+          if ((Implies(f, Sub(g, 0)) && Implies(f, Sub(g, 1)))
+              || (Is(f, FormulaForm::Release) && Implies(Sub(f, 0), Sub(g, 0)) && Implies(Sub(f, 1), Sub(g, 1)))
+              || (Is(f, FormulaForm::Global) && Implies(Sub(f, 0), Sub(g, 1)))) {
+            return true;
+          }
+          break;
+        case FormulaForm::Global:
+          if (Is(f, FormulaForm::Global) && Implies(Sub(f, 0), Sub(g, 0))) {
+            return true;
+          }
+          break;
+        default:
+          break;
+        }
 
+        switch (f.form()) {
+        case FormulaForm::Or:
+          return Implies(Sub(f, 0), g) && Implies(Sub(f, 1), g);
+        case FormulaForm::And:
+          return Implies(Sub(f, 0), g) || Implies(Sub(f, 1), g);
+        case FormulaForm::Until:
+          // (U a b) makes a or b hold now.
+          return Implies(Sub(f, 0), g) && Implies(Sub(f, 1), g);
+        case FormulaForm::Release:
+          // (R a b) makes b hold now.
+          return Implies(Sub(f, 1), g);
         case FormulaForm::Global:
-          // (! (G f)) = (F (! f)) = (U true (! f))
-          return make_until(True, Normalize(make_not(sub.getSubformulas()[0]), trueAP, falseAP));
+          return Implies(Sub(f, 0), g);
+        default:
+          return false;
+        }
+      }
+
+      // Rewrites formula, whose subformulas have already been simplified, by the first rule that applies at its root, if any.
+      template <typename AP>
+      Formula<AP> RewriteRoot(Formula<AP> const& formula) {
+        if (formula.form() == FormulaForm::Atomic || formula.form() == FormulaForm::Not) {
+          return formula;
+        }
+        auto Is = [](Formula<AP> const& f, FormulaForm form) {
+          return f.form() == form;
+        };
+        auto Sub = [](Formula<AP> const& f, size_t i) -> Formula<AP> const& {
+          return f.getSubformulas()[i];
+        };
+        // (G (F f)) and (F (G f)) do not depend on any finite prefix of a word.
+        auto PrefixIndependent = [&](Formula<AP> const& f) {
+          return (Is(f, FormulaForm::Global) && Is(Sub(f, 0), FormulaForm::Future))
+            || (Is(f, FormulaForm::Future) && Is(Sub(f, 0), FormulaForm::Global));
+        };
+        auto const& a = Sub(formula, 0);
+
+        switch (formula.form()) {
+        case FormulaForm::And: {
+          auto const& b = Sub(formula, 1);
+          if (Implies(a, b)) return a;
+          if (Implies(b, a)) return b;
+          // (&& (G a) (G b)) = (G (&& a b))
+          if (Is(a, FormulaForm::Global) && Is(b, FormulaForm::Global)) return make_global(make_and(Sub(a, 0), Sub(b, 0)));
+          // (&& (U a c) (U b c)) = (U (&& a b) c)
+          if (Is(a, FormulaForm::Until) && Is(b, FormulaForm::Until) && Sub(a, 1) == Sub(b, 1)) return make_until(make_and(Sub(a, 0), Sub(b, 0)), Sub(a, 1));
+          // (&& (R a b) (R a c)) = (R a (&& b c))
+          if (Is(a, FormulaForm::Release) && Is(b, FormulaForm::Release) && Sub(a, 0) == Sub(b, 0)) return make_release(Sub(a, 0), make_and(Sub(a, 1), Sub(b, 1)));
+          return formula;
+        }
+
+        case FormulaForm::Or: {
+          auto const& b = Sub(formula, 1);
+          if (Implies(a, b)) return b;
+          if (Implies(b, a)) return a;
+          // (|| (F a) (F b)) = (F (|| a b))
+          if (Is(a, FormulaForm::Future) && Is(b, FormulaForm::Future)) return make_future(make_or(Sub(a, 0), Sub(b, 0)));
+          // (|| (U a b) (U a c)) = (U a (|| b c))
+          if (Is(a, FormulaForm::Until) && Is(b, FormulaForm::Until) && Sub(a, 0) == Sub(b, 0)) return make_until(Sub(a, 0), make_or(Sub(a, 1), Sub(b, 1)));
+          // (|| (R a c) (R b c)) = (R (|| a b) c)
+          if (Is(a, FormulaForm::Release) && Is(b, FormulaForm::Release) && Sub(a, 1) == Sub(b, 1)) return make_release(make_or(Sub(a, 0), Sub(b, 0)), Sub(a, 1));
+          return formula;
+        }
 
         case FormulaForm::Future:
-          // (! (F f)) = (G (! f)) = (R false (! f))
-          return make_release(False, Normalize(make_not(sub.getSubformulas()[0]), trueAP, falseAP));
+          // (F (F a)) = (F a) and (F (G (F a))) = (G (F a))
+          if (Is(a, FormulaForm::Future) || PrefixIndependent(a)) return a;
+          // (F (U a b)) = (F b)
+          if (Is(a, FormulaForm::Until)) return make_future(Sub(a, 1));
+          return formula;
 
-        case FormulaForm::And:
-          return make_or(Normalize(make_not(sub.getSubformulas()[0]), trueAP, falseAP),
-                         Normalize(make_not(sub.getSubformulas()[1]), trueAP, falseAP));
+        case FormulaForm::Global:
+          // (G (G a)) = (G a) and (G (F (G a))) = (F (G a))
+          if (Is(a, FormulaForm::Global) || PrefixIndependent(a)) return a;
+          // (G (R a b)) = (G b)
+          if (Is(a, FormulaForm::Release)) return make_global(Sub(a, 1));
+          return formula;
 
-        case FormulaForm::Or:
-          return make_and(Normalize(make_not(sub.getSubformulas()[0]), trueAP, falseAP),
-                          Normalize(make_not(sub.getSubformulas()[1]), trueAP, falseAP));
+        case FormulaForm::Until: {
+          auto const& b = Sub(formula, 1);
+          // (U a b) = b if a implies b, and (U a (U a c)) = (U a c)
+          if (Implies(a, b) || (Is(b, FormulaForm::Until) && Sub(b, 0) == a)) return b;
+          // (U a (F b)) = (F b), likewise for any b a finite prefix does not matter to
+          if (Is(b, FormulaForm::Future) || PrefixIndependent(b)) return b;
+          // (U (U a b) b) = (U a b)
+          if (Is(a, FormulaForm::Until) && Sub(a, 1) == b) return a;
+          return formula;
+        }
+
+        case FormulaForm::Release: {
+          auto const& b = Sub(formula, 1);
+          // (R a b) = b if b implies a, and (R a (R a c)) = (R a c)
+          if (Implies(b, a) || (Is(b, FormulaForm::Release) && Sub(b, 0) == a)) return b;
+          // (R a (G b)) = (G b), likewise for any b a finite prefix does not matter to
+          if (Is(b, FormulaForm::Global) || PrefixIndependent(b)) return b;
+          // (R (R a b) b) = (R a b)
+          if (Is(a, FormulaForm::Release) && Sub(a, 1) == b) return a;
+          return formula;
+        }
 
+        default:
+          return formula;
+        }
+      }
+
+      // Simplifies the subformulas of formula and then formula itself, once. Results are kept in rewritten.
+      template <typename AP>
+      Formula<AP> RewriteOnce(Formula<AP> const& formula, auto_map<Formula<AP>, Formula<AP>>& rewritten) {
+        if (formula.form() == FormulaForm::Atomic) {
+          return formula;
+        }
+        auto iter = rewritten.find(formula);
+        if (iter != rewritten.end()) {
+          return iter->second;
+        }
+        auto const& subs = formula.getSubformulas();
+        Formula<AP> left = RewriteOnce(subs[0], rewritten);
+        Formula<AP> rebuilt;
+        switch (formula.form()) {
         case FormulaForm::Not:
-          return Normalize(sub.getSubformulas()[0], trueAP, falseAP);
+          rebuilt = make_not(left);
+          break;
+        case FormulaForm::Global:
+          rebuilt = make_global(left);
+          break;
+        case FormulaForm::Future:
+          rebuilt = make_future(left);
+          break;
+        case FormulaForm::And:
+          rebuilt = make_and(left, RewriteOnce(subs[1], rewritten));
+          break;
+        case FormulaForm::Or:
+          rebuilt = make_or(left, RewriteOnce(subs[1], rewritten));
+          break;
+        case FormulaForm::Until:
+          rebuilt = make_until(left, RewriteOnce(subs[1], rewritten));
+          break;
+        case FormulaForm::Release:
+          rebuilt = make_release(left, RewriteOnce(subs[1], rewritten));
+          break;
+        default:
+          rebuilt = formula;
+        }
+        Formula<AP> result = RewriteRoot(rebuilt);
+        rewritten.emplace(formula, result);
+        return result;
+      }
+    }
+
+    /**
+     * Rewrites formula into an equivalent one that is usually smaller, so that it translates to a smaller automaton.
+     * The formula is put into negation normal form (see NegationNormalForm) and then rewritten bottom up until no rule applies:
+     * rules that remove nested or repeated temporal operators, such as (F (F a)) = (F a) and (U a (U a b)) = (U a b),
+     * rules that merge operators, such as (&& (G a) (G b)) = (G (&& a b)),
+     * and rules that drop a subformula another one syntactically implies, such as (|| a b) = b when a implies b.
+     * The result still has to be normalized before it is translated.
+     */
+    template <typename AP>
+    Formula<AP> Simplify(Formula<AP> const& formula) {
+      Formula<AP> current = NegationNormalForm(formula);
+      while (true) {
+        auto_map<Formula<AP>, Formula<AP>> rewritten;
+        Formula<AP> next = _details_::RewriteOnce(current, rewritten);
+        // Formulas are hash consed, so an unchanged formula is the very same formula.
+        if (next == current) {
+          return next;
         }
+        current = next;
       }
     }
 
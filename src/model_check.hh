@@ -1,38 +1,33 @@
 #ifndef MODEL_CHECK_HH
 #define MODEL_CHECK_HH
 
+#include <optional>
+#include <string>
+
 #include "kripke.hh"
 #include "buchi.hh"
+#include "generalized_buchi.hh"
 #include "ltl.hh"
 #include "ltl_utils.hh"
 #include "kripke_to_buchi.hh"
 #include "ltl_to_buchi.hh"
+#include "ltl_lazy_tableau.hh"
+#include "ltl_to_vwaa.hh"
 #include "buchi_utils.hh"
+#include "buchi_reduction.hh"
+#include "buchi_search.hh"
+#include "dense_set.hh"
+#include "state_interner.hh"
 
 
 namespace mc {
-  template <typename State, typename AP>
-  std::optional<Lasso<State>> ModelCheck(Kripke<State, AP> const& kripke, ltl::Formula<AP> const& normalizedSpec) {
-    auto kripke_buchi = KripkeToBuchi(kripke, normalizedSpec.getAPSet());
-    auto ltl_buchi = ltl::LTLToBuchi(normalizedSpec);
-    using KripkeAlphabet = typename decltype(kripke_buchi)::AlphabetType;
-    using LTLAlphabet = typename decltype(ltl_buchi)::AlphabetType;
-
-    // This functor determines if the set of APs appearing on a transition in ltl_buchi is a subset of the APs appearing on a transition in kripke_buchi. If so then we should be able to take this transition in the intersection.
-    auto specAPSubsetKripkeAP = [](KripkeAlphabet const& kripkeAPs, LTLAlphabet const& specAPs) {
-      for (auto& [truth, ap] : specAPs) {
-        bool containsAP = (kripkeAPs.count(ap) == 1);
-        if (containsAP != truth) {
-          return false;
-        }
-      }
-      return true;
-    };
-    auto intersection = Intersection(kripke_buchi, ltl_buchi, specAPSubsetKripkeAP);
-    auto opt_lasso = FindAcceptingRun(intersection);
-    if (opt_lasso) {
-      const auto& [bloatedStem, bloatedLoop] = *opt_lasso;
-      using StatePair = std::pair<State,ltl::_details_::LTLNode<AP>>;
+  namespace _details_ {
+    // Turns a lasso through the product of a Kripke structure and a tableau, given as pairs of optional Kripke states and
+    // tableau node numbers, into the lasso of Kripke states it contains, without redundant loops.
+    template <typename State>
+    Lasso<State> KripkeLasso(std::vector<std::pair<std::optional<State>, int>> const& bloatedStem,
+                             std::vector<std::pair<std::optional<State>, int>> const& bloatedLoop) {
+      using StatePair = std::pair<State,int>;
 
       // First extract the (Kripke,LTL) state pair.
       // We need LTL included initially so that we don't accidentally trim necessary states in the processing after this phase.
@@ -41,11 +36,10 @@ namespace mc {
         longStatePairString.reserve(bloatedStateString.size() - 1);
 
         for (size_t i = 0; i < bloatedStateString.size(); ++i) {
-          auto& opt_kState = std::get<0>(std::get<0>(bloatedStateString[i]));
-          auto& opt_lState = std::get<0>(std::get<1>(bloatedStateString[i]));
-          if (opt_kState || opt_lState) {
-            longStatePairString.emplace_back(std::make_pair(*opt_kState,
-                                                            *opt_lState));
+          auto& [opt_kState, lNode] = bloatedStateString[i];
+          // Skips the initial product state, which pairs the Kripke structure's pseudo initial state with the tableau's.
+          if (opt_kState) {
+            longStatePairString.emplace_back(std::make_pair(*opt_kState, lNode));
           }
         }
         return longStatePairString;
@@ -96,11 +90,177 @@ namespace mc {
         return kripkeStateString;
       };
 
-      return std::make_optional(std::make_pair(ExtractKripkeStateString(finalStem),
-                                               ExtractKripkeStateString(finalLoop)));
-    } else {
-      return std::nullopt;
+      return std::make_pair(ExtractKripkeStateString(finalStem), ExtractKripkeStateString(finalLoop));
+    }
+  }
+
+  // How ModelCheck translates the specification to an automaton.
+  enum class LTLTranslation {
+    // Builds the whole tableau and compiles it before the search starts.
+    Tableau,
+    // Builds the tableau on the fly, only as far as the search of the product reaches (see ltl_lazy_tableau.hh).
+    LazyTableau,
+    // Goes through a very weak alternating automaton as LTL2BA does, which tends to give smaller automata (see ltl_to_vwaa.hh).
+    Alternating
+  };
+
+  inline std::optional<LTLTranslation> ParseLTLTranslation(std::string const& name) {
+    if (name == "tableau") {
+      return LTLTranslation::Tableau;
+    } else if (name == "lazy") {
+      return LTLTranslation::LazyTableau;
+    } else if (name == "vwaa") {
+      return LTLTranslation::Alternating;
+    }
+    return std::nullopt;
+  }
+
+  // Options controlling ModelCheck: how the specification is translated, along with how the product is searched.
+  struct ModelCheckOptions : SearchOptions {
+    ModelCheckOptions() = default;
+    ModelCheckOptions(SearchOptions const& searchOptions)
+      : SearchOptions(searchOptions)
+      {}
+
+    LTLTranslation translation = LTLTranslation::Tableau;
+    // Reduces the automaton of the specification by direct simulation before it is intersected (see buchi_reduction.hh).
+    // Only applies to the translations that build their automaton up front.
+    bool reduce = false;
+  };
+
+  namespace _details_ {
+    // Translates the specification up front with one of the translations that compile their automaton.
+    template <typename AP>
+    ltl::CompiledLTL<AP> CompileSpec(ltl::Formula<AP> const& normalizedSpec, LTLTranslation translation, ltl::TranslationStatistics* translationStatistics) {
+      if (translation == LTLTranslation::Alternating) {
+        return ltl::CompileVWAA(normalizedSpec, translationStatistics);
+      }
+      return ltl::CompileLTL(normalizedSpec, translationStatistics);
+    }
+
+    // Determines if the set of APs appearing on a transition of the tableau is a subset of the APs appearing on a transition of the Kripke structure.
+    // If so then we should be able to take this transition in the intersection.
+    struct SpecAPSubsetKripkeAP {
+      template <typename KripkeAlphabet, typename LTLAlphabet>
+      bool operator()(KripkeAlphabet const& kripkeAPs, LTLAlphabet const& specAPs) const {
+        for (auto& [truth, ap] : specAPs) {
+          bool containsAP = (kripkeAPs.count(ap) == 1);
+          if (containsAP != truth) {
+            return false;
+          }
+        }
+        return true;
+      }
+    };
+
+    // Searches the intersection of kripke_buchi and ltl_buchi for an accepting run, interning the product states
+    // so the search stores, hashes and compares integers rather than pairs of states.
+    // kripkeState turns a state of kripke_buchi back into the Kripke state it stands for.
+    template <typename State, typename KripkeBuchi, typename LTLBuchi, typename KripkeStateOf>
+    std::optional<Lasso<State>> SearchInternedProduct(KripkeBuchi const& kripke_buchi, LTLBuchi const& ltl_buchi, KripkeStateOf const& kripkeState,
+                                                      SearchOptions const& options, SearchStatistics* statistics) {
+      auto [intersection, productInterner] = InternStates(Intersection(kripke_buchi, ltl_buchi, SpecAPSubsetKripkeAP()));
+      auto opt_idLasso = FindAcceptingRun(intersection, options, statistics);
+      if (!opt_idLasso) {
+        return std::nullopt;
+      }
+      // Only now are the ids of the counterexample turned back into actual states.
+      // The tableau node numbers identify tableau nodes just as well as the nodes themselves, so they are kept as is.
+      auto MaterializeProduct = [&productStates = productInterner, &kripkeState](std::vector<StateId> const& ids) {
+        std::vector<std::pair<std::optional<State>, int>> states;
+        for (auto const& [kripkeId, ltlNode] : MaterializeStates(ids, *productStates)) {
+          states.emplace_back(kripkeState(kripkeId), ltlNode);
+        }
+        return states;
+      };
+      return std::make_optional(KripkeLasso(MaterializeProduct(opt_idLasso->first), MaterializeProduct(opt_idLasso->second)));
+    }
+
+    // Searches the intersection of kripke_buchi, whose states are numbered by kripkeStates, and ltl_buchi, whose states lie in ltlDomain,
+    // for an accepting run. The product states are numbered by the product of the domains and stored in bitmaps.
+    template <typename State, typename KripkeBuchi, typename KripkeDomain, typename LTLBuchi>
+    std::optional<Lasso<State>> SearchNumberedProduct(KripkeBuchi const& kripke_buchi, KripkeDomain const& kripkeStates,
+                                                      LTLBuchi const& ltl_buchi, IntegerDomain<int> const& ltlDomain,
+                                                      SearchOptions const& options, SearchStatistics* statistics) {
+      PairDomain productDomain(IntegerDomain<size_t>(0, kripkeStates.size()), ltlDomain);
+      auto [intersection, productStates] = NumberStates(Intersection(kripke_buchi, ltl_buchi, SpecAPSubsetKripkeAP()), productDomain);
+      SearchOptions denseOptions = options;
+      denseOptions.storage.denseStates = productStates->size();
+      auto opt_indexLasso = FindAcceptingRun(intersection, denseOptions, statistics);
+      if (!opt_indexLasso) {
+        return std::nullopt;
+      }
+      auto MaterializeProduct = [&productStates = productStates, &kripkeStates](std::vector<size_t> const& indices) {
+        std::vector<std::pair<std::optional<State>, int>> states;
+        for (auto const& [kripkeIndex, ltlNode] : MaterializeStates(indices, *productStates)) {
+          states.emplace_back(kripkeStates.value(kripkeIndex), ltlNode);
+        }
+        return states;
+      };
+      return std::make_optional(KripkeLasso(MaterializeProduct(opt_indexLasso->first), MaterializeProduct(opt_indexLasso->second)));
+    }
+  }
+
+  // Searches for a fair run of kripke that satisfies normalizedSpec, and returns it as a lasso if there is one.
+  // translationStatistics, if given, reports how much of the tableau of normalizedSpec was built.
+  template <typename State, typename AP, typename... Fs>
+  std::optional<Lasso<State>> ModelCheck(Kripke<State, AP, Fs...> const& kripke, ltl::Formula<AP> const& normalizedSpec, ModelCheckOptions const& options = {},
+                                         SearchStatistics* statistics = nullptr, ltl::TranslationStatistics* translationStatistics = nullptr) {
+    // Both automata keep one acceptance set per fairness constraint so the intersection does not have to count through them.
+    // The Kripke states are interned and the tableau nodes are numbered, so the intersection pairs up integers
+    // instead of copying Kripke states and tableau nodes around.
+    auto [kripke_buchi, kripkeInterner] = InternStates(KripkeToGeneralizedBuchi(kripke, normalizedSpec.getAPSet()));
+    auto KripkeState = [&kripkeStates = kripkeInterner](StateId id) {
+      return kripkeStates->state(id);
+    };
+    if (options.translation == LTLTranslation::LazyTableau) {
+      auto [ltl_buchi, lazy] = ltl::LazyToGeneralizedBuchi(normalizedSpec);
+      auto result = _details_::SearchInternedProduct<State>(kripke_buchi, ltl_buchi, KripkeState, options, statistics);
+      if (translationStatistics) {
+        *translationStatistics = lazy->statistics();
+      }
+      return result;
+    }
+    auto ltl_buchi = ltl::CompiledToGeneralizedBuchi(_details_::CompileSpec(normalizedSpec, options.translation, translationStatistics));
+    if (options.reduce) {
+      auto reduced = ReduceGeneralizedBuchi(ltl_buchi, translationStatistics ? &translationStatistics->reduction : nullptr);
+      return _details_::SearchInternedProduct<State>(kripke_buchi, reduced, KripkeState, options, statistics);
+    }
+    return _details_::SearchInternedProduct<State>(kripke_buchi, ltl_buchi, KripkeState, options, statistics);
+  }
+
+  // As above, for Kripke structures whose states all lie in the dense domain kripkeStates (see dense_set.hh).
+  // The Kripke states and the product states are then numbered by the domains instead of being interned,
+  // which needs no table of the states seen so far, and exact storage keeps the visited states in bitmaps.
+  // The lazy tableau does not know its size up front, so with it the product states are interned after all.
+  template <typename State, typename AP, typename... Fs, typename KripkeDomain>
+  std::optional<Lasso<State>> ModelCheck(Kripke<State, AP, Fs...> const& kripke, KripkeDomain const& kripkeDomain, ltl::Formula<AP> const& normalizedSpec,
+                                         ModelCheckOptions const& options = {}, SearchStatistics* statistics = nullptr,
+                                         ltl::TranslationStatistics* translationStatistics = nullptr) {
+    // The Kripke structure's pseudo initial state is std::nullopt.
+    auto [kripke_buchi, kripkeStates] = NumberStates(KripkeToGeneralizedBuchi(kripke, normalizedSpec.getAPSet()), OptionalDomain(kripkeDomain));
+    if (options.translation == LTLTranslation::LazyTableau) {
+      auto KripkeState = [&kripkeStates = kripkeStates](size_t index) {
+        return kripkeStates->value(index);
+      };
+      auto [ltl_buchi, lazy] = ltl::LazyToGeneralizedBuchi(normalizedSpec);
+      auto result = _details_::SearchInternedProduct<State>(kripke_buchi, ltl_buchi, KripkeState, options, statistics);
+      if (translationStatistics) {
+        *translationStatistics = lazy->statistics();
+      }
+      return result;
+    }
+
+    auto compiled = _details_::CompileSpec(normalizedSpec, options.translation, translationStatistics);
+    // The initial tableau node is numbered -1.
+    IntegerDomain<int> ltlDomain(-1, static_cast<int>(compiled.size()));
+    auto ltl_buchi = ltl::CompiledToGeneralizedBuchi(compiled);
+    if (options.reduce) {
+      // The reduced automaton keeps some of the node numbers, so it still fits the domain.
+      auto reduced = ReduceGeneralizedBuchi(ltl_buchi, translationStatistics ? &translationStatistics->reduction : nullptr);
+      return _details_::SearchNumberedProduct<State>(kripke_buchi, *kripkeStates, reduced, ltlDomain, options, statistics);
     }
+    return _details_::SearchNumberedProduct<State>(kripke_buchi, *kripkeStates, ltl_buchi, ltlDomain, options, statistics);
   }
 }
 
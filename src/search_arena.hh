@@ -0,0 +1,32 @@
+#ifndef SEARCH_ARENA_HH
+#define SEARCH_ARENA_HH
+
+#include <memory_resource>
+
+namespace mc {
+  /**
+   * The memory of a single search for an accepting run: its visited sets, DFS stacks and the maps that index them.
+   * A search allocates and frees these over and over, e.g. a fresh stack for every second DFS of the nested DFS
+   * and a node per state in hash compaction storage. Small blocks come from pools of same sized blocks, which pack them
+   * without per block headers and hand freed ones out again, and the pools go back to upstream all at once with the arena.
+   * Large blocks, like the arrays of the visited sets, go straight to upstream so that they are released as soon as they are regrown.
+   * An arena is not thread safe, so every thread of a parallel search has its own.
+   */
+  class SearchArena {
+  public:
+    explicit SearchArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+      : pools(upstream)
+      {}
+    SearchArena(SearchArena const&) = delete;
+    SearchArena& operator=(SearchArena const&) = delete;
+
+    std::pmr::memory_resource* resource() {
+      return &pools;
+    }
+
+  private:
+    std::pmr::unsynchronized_pool_resource pools;
+  };
+}
+
+#endif
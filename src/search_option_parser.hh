@@ -0,0 +1,158 @@
+#ifndef SEARCH_OPTION_PARSER_HH
+#define SEARCH_OPTION_PARSER_HH
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "buchi_search.hh"
+
+namespace parser {
+  // Parses the command line options shared by the drivers that control how the accepting run search is performed.
+  // Recognized options are removed from args so that only the positional arguments remain.
+  // Returns false if an option is malformed, after reporting the problem.
+  inline bool ParseSearchOptions(std::vector<std::string>& args, mc::SearchOptions& options) {
+    std::vector<std::string> positional;
+    for (size_t i = 0; i < args.size(); ++i) {
+      if (args[i] == "--search") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected an algorithm after --search.\n";
+          return false;
+        }
+        auto opt_algorithm = mc::ParseSearchAlgorithm(args[++i]);
+        if (!opt_algorithm) {
+          std::cout << "Unknown search algorithm \"" << args[i] << "\". Expected one of ndfs, scc or swarm.\n";
+          return false;
+        }
+        options.algorithm = *opt_algorithm;
+      } else if (args[i] == "--threads") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected a number of threads after --threads.\n";
+          return false;
+        }
+        try {
+          int threads = std::stoi(args[++i]);
+          if (threads < 0) {
+            throw std::out_of_range("negative thread count");
+          }
+          options.threads = threads;
+        } catch (std::exception const&) {
+          std::cout << "Could not parse \"" << args[i] << "\" as a number of threads. Must be a non-negative integer.\n";
+          return false;
+        }
+      } else if (args[i] == "--worker-memory") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected a number of megabytes after --worker-memory.\n";
+          return false;
+        }
+        try {
+          int megabytes = std::stoi(args[++i]);
+          if (megabytes < 0) {
+            throw std::out_of_range("negative memory limit");
+          }
+          options.workerMemoryLimit = static_cast<size_t>(megabytes) << 20;
+        } catch (std::exception const&) {
+          std::cout << "Could not parse \"" << args[i] << "\" as a memory limit. Must be a non-negative number of megabytes.\n";
+          return false;
+        }
+      } else if (args[i] == "--storage") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected a storage mode after --storage.\n";
+          return false;
+        }
+        auto opt_storage = mc::ParseStateStorage(args[++i]);
+        if (!opt_storage) {
+          std::cout << "Unknown storage mode \"" << args[i] << "\". Expected one of exact, bitstate or hashcompact.\n";
+          return false;
+        }
+        options.storage.mode = *opt_storage;
+      } else if (args[i] == "--bitstate-memory") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected a number of megabytes after --bitstate-memory.\n";
+          return false;
+        }
+        try {
+          int megabytes = std::stoi(args[++i]);
+          if (megabytes <= 0) {
+            throw std::out_of_range("non-positive bit array size");
+          }
+          options.storage.bitstateBytes = static_cast<size_t>(megabytes) << 20;
+        } catch (std::exception const&) {
+          std::cout << "Could not parse \"" << args[i] << "\" as a bit array size. Must be a positive number of megabytes.\n";
+          return false;
+        }
+      } else if (args[i] == "--hash-functions") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected a number of hash functions after --hash-functions.\n";
+          return false;
+        }
+        try {
+          int numHashes = std::stoi(args[++i]);
+          if (numHashes <= 0) {
+            throw std::out_of_range("non-positive hash function count");
+          }
+          options.storage.numHashes = numHashes;
+        } catch (std::exception const&) {
+          std::cout << "Could not parse \"" << args[i] << "\" as a number of hash functions. Must be a positive integer.\n";
+          return false;
+        }
+      } else if (args[i] == "--successor-cache") {
+        if (i + 1 == args.size()) {
+          std::cout << "Expected a number of states after --successor-cache.\n";
+          return false;
+        }
+        try {
+          int cacheSize = std::stoi(args[++i]);
+          if (cacheSize < 0) {
+            throw std::out_of_range("negative cache size");
+          }
+          options.successorCacheSize = cacheSize;
+        } catch (std::exception const&) {
+          std::cout << "Could not parse \"" << args[i] << "\" as a cache size. Must be a non-negative integer.\n";
+          return false;
+        }
+      } else {
+        positional.emplace_back(args[i]);
+      }
+    }
+
+    bool nestedDFSStorage = options.algorithm == mc::SearchAlgorithm::Swarm
+      || (options.algorithm == mc::SearchAlgorithm::NestedDFS && options.threads == 1);
+    if (options.storage.mode != mc::StateStorage::Exact && !nestedDFSStorage) {
+      std::cout << "Approximate storage is only supported by the sequential nested DFS and the swarm.\n";
+      return false;
+    }
+    args = positional;
+    return true;
+  }
+
+  // Reports the statistics of the optional search features that were turned on in options:
+  // how many states an approximate storage mode stored and how likely it is that it skipped some, and how well the successor cache did.
+  // Prints nothing by default so the output of the drivers stays the same.
+  inline void PrintSearchStatistics(mc::SearchOptions const& options, mc::SearchStatistics const& statistics) {
+    if (options.storage.mode != mc::StateStorage::Exact) {
+      std::cout << "Stored " << statistics.storedStates << " states in " << statistics.storageBytes << " bytes. "
+                << "Estimated probability that states were missed: " << statistics.omissionProbability << "\n";
+    }
+    if (options.successorCacheSize != 0) {
+      std::cout << "Successor cache: " << statistics.cacheHits << " hits, " << statistics.cacheMisses << " misses.\n";
+    }
+  }
+
+  inline void PrintSearchOptionsUsage() {
+    std::cout << "Search options:\n";
+    std::cout << "  --search <ndfs|scc|swarm>  Algorithm used to look for an accepting run: nested DFS (default), Couvreur's SCC algorithm\n";
+    std::cout << "                             or a swarm of independent randomized nested DFS searches.\n";
+    std::cout << "  --threads <n>              Number of threads the nested DFS (CNDFS when more than 1) or the swarm runs on. 0 uses every hardware thread.\n";
+    std::cout << "  --worker-memory <mb>       Memory limit of the visited sets of each swarm worker in megabytes. 0 (the default) means no limit.\n";
+    std::cout << "  --storage <exact|bitstate|hashcompact>\n";
+    std::cout << "                             How visited states are stored: in full (default), as bits of a fixed size bit array\n";
+    std::cout << "                             or as 64 bit fingerprints. The approximate modes may miss states and report how likely that is.\n";
+    std::cout << "  --bitstate-memory <mb>     Size of the bit arrays of bitstate storage in megabytes. Defaults to 64.\n";
+    std::cout << "  --hash-functions <k>       Number of bits bitstate storage sets per state. Defaults to 3.\n";
+    std::cout << "  --successor-cache <n>      Caches the transitions of the n most recently expanded states. 0 (the default) disables the cache.\n";
+  }
+}
+
+#endif
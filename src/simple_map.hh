@@ -3,9 +3,11 @@
 
 #include <vector>
 #include <initializer_list>
+#include <memory>
 #include <utility>
 #include <functional>
 #include <variant>
+#include <stdexcept>
 
 #include "simple_set.hh"
 
@@ -14,13 +16,15 @@ namespace mc {
    * A class representing a (unordered) map that is compatible with any key which has ==.
    * Only having == makes it hard to implement this class efficiently.
    */
-  template <typename K, typename V, typename KEqual = std::equal_to<K>>
+  template <typename K, typename V, typename KEqual = std::equal_to<K>, typename Allocator = std::allocator<std::pair<const K, V>>>
   class simple_map {
   private:
-    using underlying_representation = std::vector<std::pair<K,V>>;
+    using underlying_representation =
+      std::vector<std::pair<K,V>, typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<K,V>>>;
     
   public:
     using value_type = std::pair<const K, V>;
+    using allocator_type = Allocator;
     // Leaky abstraction here. Reveals what the underlying type is but works for now.
     using iterator = typename underlying_representation::iterator;
     using const_iterator = typename underlying_representation::const_iterator;
@@ -28,8 +32,9 @@ namespace mc {
     simple_map() = default;
     simple_map(simple_map const&) = default;
     simple_map(simple_map&&) = default;
+    explicit simple_map(Allocator const& allocator) : map(allocator) {}
     template <typename InputIt>
-    simple_map(InputIt first, InputIt last) : map(first, last) {}
+    simple_map(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : map(first, last, allocator) {}
     simple_map(std::initializer_list<std::pair<K,V>> init) : map(init) {}
     ~simple_map() = default;
 
@@ -46,6 +51,10 @@ namespace mc {
       return map != rhs.map;
     }
 
+    allocator_type get_allocator() const {
+      return allocator_type(map.get_allocator());
+    }
+
     iterator begin() {
       return map.begin();
     }
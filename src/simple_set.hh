@@ -3,27 +3,44 @@
 
 #include <vector>
 #include <initializer_list>
+#include <memory>
 #include <utility>
 #include <functional>
 
+#include "auto_traits.hh"
+
 namespace mc {
   /**
    * A class representing a (unordered) set that is compatible with any type which has ==.
    * Only having == makes it hard to implement this class efficiently.
    */
-  template <typename T, typename TEqual = std::equal_to<T>>
+  template <typename T, typename TEqual = std::equal_to<T>, typename Allocator = std::allocator<T>>
   class simple_set {
+  private:
+    using underlying_representation = std::vector<T, Allocator>;
+
   public:
+    using allocator_type = Allocator;
     // Leaky abstraction here. Reveals what the underlying type is but works for now.
-    using iterator = typename std::vector<T>::const_iterator;
-    using const_iterator = typename std::vector<T>::const_iterator;
+    using iterator = typename underlying_representation::const_iterator;
+    using const_iterator = typename underlying_representation::const_iterator;
 
     simple_set() = default;
     simple_set(simple_set const&) = default;
     simple_set(simple_set&&) = default;
+    explicit simple_set(Allocator const& allocator) : set(allocator) {}
+    // Duplicates are dropped if T has ==. Types without it can still be stored as long as nothing is looked up.
     template <typename InputIt>
-    simple_set(InputIt first, InputIt last) : set(first, last) {}
-    simple_set(std::initializer_list<T> init) : set(init) {}
+    simple_set(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : set(allocator) {
+      if constexpr (traits::equality_comparable<T>::value) {
+        for (; first != last; ++first) {
+          insert(*first);
+        }
+      } else {
+        set.assign(first, last);
+      }
+    }
+    simple_set(std::initializer_list<T> init) : simple_set(init.begin(), init.end()) {}
     ~simple_set() = default;
 
     simple_set& operator=(simple_set const&) = default;
@@ -39,6 +56,10 @@ namespace mc {
       return set != rhs.set;
     }
 
+    allocator_type get_allocator() const {
+      return set.get_allocator();
+    }
+
     iterator begin() {
       return set.begin();
     }
@@ -128,7 +149,7 @@ namespace mc {
       return std::make_pair(matchIter, false);
     }
     
-    std::vector<T> set;
+    underlying_representation set;
   };
 }
 
@@ -0,0 +1,250 @@
+#ifndef SMALL_MAP_HH
+#define SMALL_MAP_HH
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <variant>
+
+#include "small_set.hh"
+
+namespace mc {
+  /**
+   * A class representing a (unordered) map that stores up to N key value pairs inline, found by a linear scan with ==,
+   * and only moves them into the Large map representation once it outgrows them.
+   * A map that has grown stays in the Large representation until it is cleared.
+   * Allocators are handled as in small_set.
+   */
+  template <typename K, typename V, size_t N, typename Large>
+  class small_map {
+  private:
+    // The inline pairs have the same type as the pairs of Large, so that both tiers can share an iterator type.
+    using stored_type = typename std::iterator_traits<typename Large::iterator>::value_type;
+    using Inline = _details_::InlineBuffer<stored_type,N>;
+
+  public:
+    using value_type = std::pair<const K, V>;
+    using allocator_type = typename Large::allocator_type;
+    using iterator = _details_::TieredIterator<stored_type*, typename Large::iterator>;
+    using const_iterator = _details_::TieredIterator<stored_type const*, typename Large::const_iterator>;
+
+    small_map() = default;
+    small_map(small_map const& other)
+      : allocator(std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator)),
+        map(other.map)
+      {}
+    small_map(small_map&&) = default;
+    explicit small_map(allocator_type const& allocator) : allocator(allocator) {}
+    small_map(Large const& map) : small_map(Large(map)) {}
+    small_map(Large&& map) : allocator(map.get_allocator()), map(std::move(map)) {}
+    template <typename InputIt>
+    small_map(InputIt first, InputIt last, allocator_type const& allocator = allocator_type()) : allocator(allocator) {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+    }
+    small_map(std::initializer_list<std::pair<K,V>> init) : small_map(init.begin(), init.end()) {}
+    ~small_map() = default;
+
+    small_map& operator=(small_map const& other) {
+      if (this != &other) {
+        *this = small_map(other.begin(), other.end(), allocator);
+      }
+      return *this;
+    }
+    small_map& operator=(small_map&& other) {
+      if (this != &other) {
+        if (allocator == other.allocator) {
+          map = std::move(other.map);
+        } else {
+          *this = small_map(other.begin(), other.end(), allocator);
+        }
+      }
+      return *this;
+    }
+    small_map& operator=(std::initializer_list<std::pair<K,V>> init) {
+      return *this = small_map(init);
+    }
+
+    // Two equal maps can be in different tiers, e.g. if one of them grew and then shrank again.
+    bool operator==(small_map const& rhs) const {
+      if (size() != rhs.size()) {
+        return false;
+      }
+      for (auto const& [key, value] : *this) {
+        auto match = rhs.find(key);
+        if (match == rhs.end() || !(match->second == value)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    bool operator!=(small_map const& rhs) const {
+      return !(*this == rhs);
+    }
+
+    allocator_type get_allocator() const {
+      return allocator;
+    }
+
+    iterator begin() {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        return iterator(buffer->begin());
+      }
+      return iterator(std::get<Large>(map).begin());
+    }
+    const_iterator begin() const {
+      return const_cast<small_map*>(this)->begin();
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+
+    iterator end() {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        return iterator(buffer->end());
+      }
+      return iterator(std::get<Large>(map).end());
+    }
+    const_iterator end() const {
+      return const_cast<small_map*>(this)->end();
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    iterator find(const K& key) {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        return iterator(inlineFind(*buffer, key));
+      }
+      return iterator(std::get<Large>(map).find(key));
+    }
+    const_iterator find(const K& key) const {
+      return const_cast<small_map*>(this)->find(key);
+    }
+
+    std::pair<iterator,bool> insert(const value_type& kv) {
+      return forwarding_insert(kv.first, kv);
+    }
+    std::pair<iterator,bool> insert(value_type&& kv) {
+      return forwarding_insert(kv.first, std::move(kv));
+    }
+
+    template <typename... Args>
+    std::pair<iterator,bool> emplace(Args&&... args) {
+      std::pair<K,V> kv (std::forward<Args>(args)...);
+      return forwarding_insert(kv.first, std::move(kv));
+    }
+
+    iterator erase(const_iterator pos) {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        return iterator(buffer->erase(pos.inlinePos));
+      }
+      return iterator(std::get<Large>(map).erase(pos.largePos));
+    }
+    size_t erase(const K& key) {
+      auto matchIter = find(key);
+      if (matchIter != end()) {
+        erase(matchIter);
+        return 1;
+      }
+      return 0;
+    }
+
+    void clear() {
+      map = Inline();
+    }
+
+    V& at(const K& key) {
+      return const_cast<V&>(static_cast<const small_map*>(this)->at(key));
+    }
+    const V& at(const K& key) const {
+      const_iterator match = find(key);
+      if (match == end()) {
+        throw std::out_of_range("Attempt to access value at a key that does not exist");
+      }
+      return match->second;
+    }
+
+    V& operator[](const K& key) {
+      return forwarding_access(key);
+    }
+    V& operator[](K&& key) {
+      return forwarding_access(std::move(key));
+    }
+
+    size_t count(const K& key) const {
+      return find(key) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        return buffer->size();
+      }
+      return std::get<Large>(map).size();
+    }
+    bool empty() const {
+      return size() == 0;
+    }
+
+  private:
+    static stored_type* inlineFind(Inline& buffer, const K& key) {
+      for (stored_type* iter = buffer.begin(); iter != buffer.end(); ++iter) {
+        if (iter->first == key) {
+          return iter;
+        }
+      }
+      return buffer.end();
+    }
+
+    template <typename F>
+    std::pair<iterator, bool> forwarding_insert(const K& key, F&& forward_kv) {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        stored_type* matchIter = inlineFind(*buffer, key);
+        if (matchIter != buffer->end()) {
+          return std::make_pair(iterator(matchIter), false);
+        }
+        if (!buffer->full()) {
+          return std::make_pair(iterator(buffer->emplace_back(std::forward<F>(forward_kv))), true);
+        }
+        grow(*buffer);
+      }
+      auto [largeIter, inserted] = std::get<Large>(map).insert(value_type(std::forward<F>(forward_kv)));
+      return std::make_pair(iterator(largeIter), inserted);
+    }
+
+    template <typename F>
+    V& forwarding_access(F&& forward_key) {
+      if (auto buffer = std::get_if<Inline>(&map)) {
+        stored_type* matchIter = inlineFind(*buffer, forward_key);
+        if (matchIter != buffer->end()) {
+          return matchIter->second;
+        }
+        if (!buffer->full()) {
+          return buffer->emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<F>(forward_key)),
+                                      std::forward_as_tuple())->second;
+        }
+        grow(*buffer);
+      }
+      return std::get<Large>(map)[std::forward<F>(forward_key)];
+    }
+
+    // Moves the full inline buffer into the large representation.
+    void grow(Inline& buffer) {
+      Large large(allocator);
+      for (stored_type& kv : buffer) {
+        large.insert(value_type(std::move(kv)));
+      }
+      map = std::move(large);
+    }
+
+    [[no_unique_address]] allocator_type allocator;
+    std::variant<Inline, Large> map;
+  };
+}
+
+#endif
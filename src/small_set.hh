@@ -0,0 +1,366 @@
+#ifndef SMALL_SET_HH
+#define SMALL_SET_HH
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace mc {
+  namespace _details_ {
+    // How many elements of type T small sets and maps keep inline by default: as many as fit in 64 bytes, but at least 2 and at most 8.
+    template <typename T>
+    constexpr size_t DefaultInlineCapacity = (64 / sizeof(T) < 2) ? 2 : (64 / sizeof(T) > 8) ? 8 : 64 / sizeof(T);
+
+    // Room for up to N elements stored inside the object itself. Erasing moves the last element into the hole.
+    template <typename T, size_t N>
+    class InlineBuffer {
+    public:
+      InlineBuffer() = default;
+      InlineBuffer(InlineBuffer const& other) {
+        for (auto const& value : other) {
+          emplace_back(value);
+        }
+      }
+      InlineBuffer(InlineBuffer&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        for (auto& value : other) {
+          emplace_back(std::move(value));
+        }
+      }
+      ~InlineBuffer() {
+        clear();
+      }
+
+      InlineBuffer& operator=(InlineBuffer const& other) {
+        if (this != &other) {
+          clear();
+          for (auto const& value : other) {
+            emplace_back(value);
+          }
+        }
+        return *this;
+      }
+      InlineBuffer& operator=(InlineBuffer&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (this != &other) {
+          clear();
+          for (auto& value : other) {
+            emplace_back(std::move(value));
+          }
+        }
+        return *this;
+      }
+
+      T* begin() {
+        return std::launder(reinterpret_cast<T*>(storage));
+      }
+      T const* begin() const {
+        return std::launder(reinterpret_cast<T const*>(storage));
+      }
+      T* end() {
+        return begin() + count;
+      }
+      T const* end() const {
+        return begin() + count;
+      }
+
+      size_t size() const {
+        return count;
+      }
+      bool full() const {
+        return count == N;
+      }
+
+      template <typename... Args>
+      T* emplace_back(Args&&... args) {
+        T* slot = new (&storage[count * sizeof(T)]) T(std::forward<Args>(args)...);
+        ++count;
+        return slot;
+      }
+
+      // Erases the element at pos by moving the last element into its place. Returns pos.
+      T* erase(T const* pos) {
+        T* hole = begin() + (pos - begin());
+        T* last = end() - 1;
+        hole->~T();
+        if (hole != last) {
+          new (hole) T(std::move(*last));
+          last->~T();
+        }
+        --count;
+        return hole;
+      }
+
+      void clear() {
+        for (T& value : *this) {
+          value.~T();
+        }
+        count = 0;
+      }
+
+    private:
+      alignas(T) unsigned char storage[N * sizeof(T)];
+      size_t count = 0;
+    };
+
+    // Iterator over either the inline elements of a small_set or small_map or its large representation.
+    template <typename InlineIter, typename LargeIter>
+    class TieredIterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = typename std::iterator_traits<LargeIter>::value_type;
+      using difference_type = std::ptrdiff_t;
+      using pointer = typename std::iterator_traits<LargeIter>::pointer;
+      using reference = typename std::iterator_traits<LargeIter>::reference;
+
+      TieredIterator() = default;
+      TieredIterator(InlineIter inlinePos) : inlinePos(inlinePos), isInline(true) {}
+      TieredIterator(LargeIter largePos) : largePos(largePos), isInline(false) {}
+      // Allows converting iterators to const_iterators.
+      template <typename OtherInlineIter, typename OtherLargeIter,
+                typename = std::enable_if_t<std::is_convertible_v<OtherInlineIter, InlineIter>
+                                            && std::is_convertible_v<OtherLargeIter, LargeIter>
+                                            && !std::is_same_v<OtherLargeIter, LargeIter>>>
+      TieredIterator(TieredIterator<OtherInlineIter, OtherLargeIter> const& other)
+        : inlinePos(other.inlinePos), largePos(other.largePos), isInline(other.isInline)
+        {}
+
+      reference operator*() const {
+        return isInline ? *inlinePos : *largePos;
+      }
+      pointer operator->() const {
+        return isInline ? inlinePos : &*largePos;
+      }
+
+      TieredIterator& operator++() {
+        if (isInline) {
+          ++inlinePos;
+        } else {
+          ++largePos;
+        }
+        return *this;
+      }
+      TieredIterator operator++(int) {
+        TieredIterator old = *this;
+        ++*this;
+        return old;
+      }
+
+      bool operator==(TieredIterator const& rhs) const {
+        return isInline ? inlinePos == rhs.inlinePos : largePos == rhs.largePos;
+      }
+      bool operator!=(TieredIterator const& rhs) const {
+        return !(*this == rhs);
+      }
+
+      InlineIter inlinePos = InlineIter();
+      LargeIter largePos = LargeIter();
+      bool isInline = true;
+    };
+  }
+
+  /**
+   * A class representing a (unordered) set that stores up to N elements inline, found by a linear scan with ==,
+   * and only moves them into the Large set representation once it outgrows them. Most sets built while
+   * searching (labels, successors, AP subsets) are tiny, and this saves them a heap allocation each.
+   * A set that has grown stays in the Large representation until it is cleared.
+   * The set keeps Large's allocator while it is inline so that it can hand it to Large when growing.
+   */
+  template <typename T, size_t N, typename Large>
+  class small_set {
+  private:
+    using Inline = _details_::InlineBuffer<T,N>;
+
+  public:
+    using allocator_type = typename Large::allocator_type;
+    using iterator = _details_::TieredIterator<T const*, typename Large::const_iterator>;
+    using const_iterator = iterator;
+
+    small_set() = default;
+    // As with the std containers, a copy uses the allocator that select_on_container_copy_construction picks,
+    // e.g. a copy of a set in a std::pmr arena gets the default memory resource rather than the arena.
+    small_set(small_set const& other)
+      : allocator(std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator)),
+        set(other.set)
+      {}
+    small_set(small_set&&) = default;
+    explicit small_set(allocator_type const& allocator) : allocator(allocator) {}
+    small_set(Large const& set) : small_set(Large(set)) {}
+    small_set(Large&& set) : allocator(set.get_allocator()), set(std::move(set)) {}
+    // A range that does not fit inline is handed to Large in one go, which lets sorted_vector_set sort it once.
+    template <typename InputIt>
+    small_set(InputIt first, InputIt last, allocator_type const& allocator = allocator_type()) : allocator(allocator) {
+      using Category = typename std::iterator_traits<InputIt>::iterator_category;
+      if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>) {
+        // The std hash sets have no constructor taking just a range and an allocator.
+        if constexpr (std::is_constructible_v<Large, InputIt, InputIt, allocator_type const&>) {
+          if (static_cast<size_t>(std::distance(first, last)) > N) {
+            set = Large(first, last, allocator);
+            return;
+          }
+        }
+      }
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+    }
+    small_set(std::initializer_list<T> init) : small_set(init.begin(), init.end()) {}
+    ~small_set() = default;
+
+    // The allocator stays the same on assignment, as it does for the std containers.
+    small_set& operator=(small_set const& other) {
+      if (this != &other) {
+        *this = small_set(other.begin(), other.end(), allocator);
+      }
+      return *this;
+    }
+    small_set& operator=(small_set&& other) {
+      if (this != &other) {
+        if (allocator == other.allocator) {
+          set = std::move(other.set);
+        } else {
+          *this = small_set(other.begin(), other.end(), allocator);
+        }
+      }
+      return *this;
+    }
+    small_set& operator=(std::initializer_list<T> init) {
+      return *this = small_set(init);
+    }
+
+    // Two equal sets can be in different tiers, e.g. if one of them grew and then shrank again.
+    bool operator==(small_set const& rhs) const {
+      if (size() != rhs.size()) {
+        return false;
+      }
+      for (auto const& value : *this) {
+        if (rhs.count(value) == 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+    bool operator!=(small_set const& rhs) const {
+      return !(*this == rhs);
+    }
+
+    allocator_type get_allocator() const {
+      return allocator;
+    }
+
+    const_iterator begin() const {
+      if (auto buffer = std::get_if<Inline>(&set)) {
+        return const_iterator(buffer->begin());
+      }
+      return const_iterator(std::get<Large>(set).begin());
+    }
+    const_iterator cbegin() const {
+      return begin();
+    }
+
+    const_iterator end() const {
+      if (auto buffer = std::get_if<Inline>(&set)) {
+        return const_iterator(buffer->end());
+      }
+      return const_iterator(std::get<Large>(set).end());
+    }
+    const_iterator cend() const {
+      return end();
+    }
+
+    const_iterator find(const T& value) const {
+      if (auto buffer = std::get_if<Inline>(&set)) {
+        return const_iterator(inlineFind(*buffer, value));
+      }
+      return const_iterator(std::get<Large>(set).find(value));
+    }
+
+    std::pair<iterator,bool> insert(const T& value) {
+      return forwarding_insert(value);
+    }
+    std::pair<iterator,bool> insert(T&& value) {
+      return forwarding_insert(std::move(value));
+    }
+
+    template <typename... Args>
+    std::pair<iterator,bool> emplace(Args&&... args) {
+      return forwarding_insert(T(std::forward<Args>(args)...));
+    }
+
+    iterator erase(const_iterator pos) {
+      if (auto buffer = std::get_if<Inline>(&set)) {
+        return iterator(buffer->erase(pos.inlinePos));
+      }
+      return iterator(std::get<Large>(set).erase(pos.largePos));
+    }
+    size_t erase(const T& value) {
+      auto matchIter = find(value);
+      if (matchIter != end()) {
+        erase(matchIter);
+        return 1;
+      }
+      return 0;
+    }
+
+    void clear() {
+      set = Inline();
+    }
+
+    size_t count(const T& value) const {
+      return find(value) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+      if (auto buffer = std::get_if<Inline>(&set)) {
+        return buffer->size();
+      }
+      return std::get<Large>(set).size();
+    }
+    bool empty() const {
+      return size() == 0;
+    }
+
+  private:
+    static T const* inlineFind(Inline const& buffer, const T& value) {
+      for (T const* iter = buffer.begin(); iter != buffer.end(); ++iter) {
+        if (*iter == value) {
+          return iter;
+        }
+      }
+      return buffer.end();
+    }
+
+    template <typename F>
+    std::pair<iterator, bool> forwarding_insert(F&& value) {
+      if (auto buffer = std::get_if<Inline>(&set)) {
+        T const* matchIter = inlineFind(*buffer, value);
+        if (matchIter != buffer->end()) {
+          return std::make_pair(iterator(matchIter), false);
+        }
+        if (!buffer->full()) {
+          return std::make_pair(iterator(buffer->emplace_back(std::forward<F>(value))), true);
+        }
+        grow(*buffer);
+      }
+      auto [largeIter, inserted] = std::get<Large>(set).insert(std::forward<F>(value));
+      return std::make_pair(iterator(largeIter), inserted);
+    }
+
+    // Moves the full inline buffer into the large representation.
+    void grow(Inline& buffer) {
+      Large large(allocator);
+      for (T& value : buffer) {
+        large.insert(std::move(value));
+      }
+      set = std::move(large);
+    }
+
+    [[no_unique_address]] allocator_type allocator;
+    std::variant<Inline, Large> set;
+  };
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef SORTED_VECTOR_MAP_HH
+#define SORTED_VECTOR_MAP_HH
+
+#include <algorithm>
+#include <vector>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+
+namespace mc {
+  /**
+   * A class representing a (unordered) map that is compatible with any key which has <.
+   * The key value pairs are kept sorted by key in one contiguous vector, so lookups are binary searches.
+   * Inserting and erasing are linear, which is fine for the small maps this is used for.
+   */
+  template <typename K, typename V, typename KLess = std::less<K>, typename Allocator = std::allocator<std::pair<const K, V>>>
+  class sorted_vector_map {
+  private:
+    using underlying_representation =
+      std::vector<std::pair<K,V>, typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<K,V>>>;
+
+  public:
+    using value_type = std::pair<const K, V>;
+    using allocator_type = Allocator;
+    // Leaky abstraction here, as in simple_map. Reveals what the underlying type is but works for now.
+    using iterator = typename underlying_representation::iterator;
+    using const_iterator = typename underlying_representation::const_iterator;
+
+    sorted_vector_map() = default;
+    sorted_vector_map(sorted_vector_map const&) = default;
+    sorted_vector_map(sorted_vector_map&&) = default;
+    explicit sorted_vector_map(Allocator const& allocator) : map(allocator) {}
+    template <typename InputIt>
+    sorted_vector_map(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : map(allocator) {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+    }
+    sorted_vector_map(std::initializer_list<std::pair<K,V>> init) : sorted_vector_map(init.begin(), init.end()) {}
+    ~sorted_vector_map() = default;
+
+    sorted_vector_map& operator=(sorted_vector_map const&) = default;
+    sorted_vector_map& operator=(sorted_vector_map&&) = default;
+    sorted_vector_map& operator=(std::initializer_list<std::pair<K,V>> init) {
+      return *this = sorted_vector_map(init);
+    }
+
+    bool operator==(sorted_vector_map const& rhs) const {
+      return map == rhs.map;
+    }
+    bool operator!=(sorted_vector_map const& rhs) const {
+      return map != rhs.map;
+    }
+
+    allocator_type get_allocator() const {
+      return allocator_type(map.get_allocator());
+    }
+
+    iterator begin() {
+      return map.begin();
+    }
+    const_iterator begin() const {
+      return map.begin();
+    }
+    const_iterator cbegin() const {
+      return map.cbegin();
+    }
+
+    iterator end() {
+      return map.end();
+    }
+    const_iterator end() const {
+      return map.end();
+    }
+    const_iterator cend() const {
+      return map.cend();
+    }
+
+    iterator find(const K& key) {
+      auto iter = lowerBound(key);
+      return (iter != map.end() && !KLess{}(key, iter->first)) ? iter : map.end();
+    }
+    const_iterator find(const K& key) const {
+      return const_cast<sorted_vector_map*>(this)->find(key);
+    }
+
+    std::pair<iterator,bool> insert(const value_type& kv) {
+      return forwarding_insert(kv.first, kv);
+    }
+    std::pair<iterator,bool> insert(value_type&& kv) {
+      return forwarding_insert(kv.first, std::move(kv));
+    }
+
+    template <typename... Args>
+    std::pair<iterator,bool> emplace(Args&&... args) {
+      std::pair<K,V> kv (std::forward<Args>(args)...);
+      return forwarding_insert(kv.first, std::move(kv));
+    }
+
+    iterator erase(const_iterator pos) {
+      return map.erase(pos);
+    }
+    size_t erase(const K& key) {
+      auto matchIter = find(key);
+      if (matchIter != end()) {
+        erase(matchIter);
+        return 1;
+      }
+      return 0;
+    }
+
+    void clear() {
+      map.clear();
+    }
+
+    V& at(const K& key) {
+      return const_cast<V&>(static_cast<const sorted_vector_map*>(this)->at(key));
+    }
+    const V& at(const K& key) const {
+      const_iterator match = find(key);
+      if (match == end()) {
+        throw std::out_of_range("Attempt to access value at a key that does not exist");
+      }
+      return match->second;
+    }
+
+    V& operator[](const K& key) {
+      return forwarding_access(key);
+    }
+    V& operator[](K&& key) {
+      return forwarding_access(std::move(key));
+    }
+
+    size_t count(const K& key) const {
+      return find(key) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+      return map.size();
+    }
+    bool empty() const {
+      return map.empty();
+    }
+
+  private:
+    iterator lowerBound(const K& key) {
+      return std::lower_bound(map.begin(), map.end(), key, [](std::pair<K,V> const& kv, K const& key) {
+        return KLess{}(kv.first, key);
+      });
+    }
+
+    template <typename F>
+    std::pair<iterator, bool> forwarding_insert(const K& key, F&& forward_kv) {
+      auto iter = lowerBound(key);
+      if (iter != map.end() && !KLess{}(key, iter->first)) {
+        return std::make_pair(iter, false);
+      }
+      return std::make_pair(map.emplace(iter, std::forward<F>(forward_kv)), true);
+    }
+
+    template <typename F>
+    V& forwarding_access(F&& forward_key) {
+      auto iter = lowerBound(forward_key);
+      if (iter == map.end() || KLess{}(forward_key, iter->first)) {
+        iter = map.emplace(iter, std::forward<F>(forward_key), V{});
+      }
+      return iter->second;
+    }
+
+    underlying_representation map;
+  };
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef SORTED_VECTOR_SET_HH
+#define SORTED_VECTOR_SET_HH
+
+#include <algorithm>
+#include <vector>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <functional>
+
+namespace mc {
+  /**
+   * A class representing a (unordered) set that is compatible with any type which has <.
+   * The elements are kept sorted in one contiguous vector, so lookups are binary searches that stay in cache
+   * and small sets cost a single allocation. Inserting and erasing are linear, which is fine for the small sets this is used for.
+   */
+  template <typename T, typename TLess = std::less<T>, typename Allocator = std::allocator<T>>
+  class sorted_vector_set {
+  private:
+    using underlying_representation = std::vector<T, Allocator>;
+
+  public:
+    using allocator_type = Allocator;
+    // Elements are immutable so that the vector stays sorted.
+    using iterator = typename underlying_representation::const_iterator;
+    using const_iterator = typename underlying_representation::const_iterator;
+
+    sorted_vector_set() = default;
+    sorted_vector_set(sorted_vector_set const&) = default;
+    sorted_vector_set(sorted_vector_set&&) = default;
+    explicit sorted_vector_set(Allocator const& allocator) : set(allocator) {}
+    template <typename InputIt>
+    sorted_vector_set(InputIt first, InputIt last, Allocator const& allocator = Allocator()) : set(first, last, allocator) {
+      sortUnique();
+    }
+    sorted_vector_set(std::initializer_list<T> init) : set(init) {
+      sortUnique();
+    }
+    ~sorted_vector_set() = default;
+
+    sorted_vector_set& operator=(sorted_vector_set const&) = default;
+    sorted_vector_set& operator=(sorted_vector_set&&) = default;
+    sorted_vector_set& operator=(std::initializer_list<T> init) {
+      set = init;
+      sortUnique();
+      return *this;
+    }
+
+    bool operator==(sorted_vector_set const& rhs) const {
+      return set == rhs.set;
+    }
+    bool operator!=(sorted_vector_set const& rhs) const {
+      return set != rhs.set;
+    }
+
+    allocator_type get_allocator() const {
+      return set.get_allocator();
+    }
+
+    iterator begin() {
+      return set.begin();
+    }
+    const_iterator begin() const {
+      return set.begin();
+    }
+    const_iterator cbegin() const {
+      return set.cbegin();
+    }
+
+    iterator end() {
+      return set.end();
+    }
+    const_iterator end() const {
+      return set.end();
+    }
+    const_iterator cend() const {
+      return set.cend();
+    }
+
+    iterator find(const T& value) {
+      return static_cast<const sorted_vector_set*>(this)->find(value);
+    }
+    const_iterator find(const T& value) const {
+      auto iter = std::lower_bound(set.begin(), set.end(), value, TLess{});
+      if (iter != set.end() && !TLess{}(value, *iter)) {
+        return iter;
+      }
+      return set.end();
+    }
+
+    std::pair<iterator,bool> insert(const T& value) {
+      return forwarding_insert(value);
+    }
+    std::pair<iterator,bool> insert(T&& value) {
+      return forwarding_insert(std::move(value));
+    }
+
+    template <typename... Args>
+    std::pair<iterator,bool> emplace(Args&&... args) {
+      return forwarding_insert(T(std::forward<Args>(args)...));
+    }
+
+    iterator erase(const_iterator pos) {
+      return set.erase(pos);
+    }
+    size_t erase(const T& value) {
+      auto matchIter = find(value);
+      if (matchIter != end()) {
+        erase(matchIter);
+        return 1;
+      }
+      return 0;
+    }
+
+    void clear() {
+      set.clear();
+    }
+
+    size_t count(const T& value) const {
+      return find(value) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+      return set.size();
+    }
+    bool empty() const {
+      return set.empty();
+    }
+
+  private:
+    template <typename F>
+    std::pair<iterator, bool> forwarding_insert(F&& value) {
+      auto iter = std::lower_bound(set.begin(), set.end(), value, TLess{});
+      if (iter != set.end() && !TLess{}(value, *iter)) {
+        return std::make_pair(iter, false);
+      }
+      return std::make_pair(set.insert(iter, std::forward<F>(value)), true);
+    }
+
+    void sortUnique() {
+      std::sort(set.begin(), set.end(), TLess{});
+      auto equivalent = [](T const& lhs, T const& rhs) {
+        return !TLess{}(lhs, rhs) && !TLess{}(rhs, lhs);
+      };
+      set.erase(std::unique(set.begin(), set.end(), equivalent), set.end());
+    }
+
+    underlying_representation set;
+  };
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef STATE_INTERNER_HH
+#define STATE_INTERNER_HH
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buchi.hh"
+#include "generalized_buchi.hh"
+#include "buchi_utils.hh"
+#include "dense_set.hh"
+#include "hash.hh"
+
+namespace mc {
+  // Dense id of an interned state.
+  using StateId = std::uint32_t;
+
+  // Assigns every distinct state a dense id (0, 1, 2, ...) the first time it is seen and remembers the state behind each id.
+  // Searches can then store, hash and compare small integers instead of full states.
+  // Safe to use from several threads at once, since the parallel searches expand states concurrently.
+  template <typename S>
+  class StateInterner {
+  public:
+    StateId intern(S const& state) {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto iter = ids.find(state);
+      if (iter != ids.end()) {
+        return iter->second;
+      }
+      if (states.size() == std::numeric_limits<StateId>::max()) {
+        throw std::length_error("Too many states to intern.");
+      }
+      StateId id = static_cast<StateId>(states.size());
+      ids.emplace(state, id);
+      states.emplace_back(state);
+      return id;
+    }
+
+    // The state with the given id. The reference stays valid for the lifetime of the interner.
+    S const& state(StateId id) const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return states.at(id);
+    }
+
+    size_t size() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return states.size();
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::unordered_map<S, StateId, Hash<S>> ids;
+    // A deque so that references returned by state() survive new states being interned.
+    std::deque<S> states;
+  };
+
+  // Builds the equivalent generalized Buchi automaton whose states are the interned ids of the states of gBuchi.
+  // States are interned lazily, as the automaton is explored. Returns the automaton along with its interner,
+  // which is needed to turn ids (e.g. those in a lasso) back into states.
+  template <typename S, typename A, typename... Fs>
+  auto InternStates(GeneralizedBuchi<S,A,Fs...> const& gBuchi) {
+    auto interner = std::make_shared<StateInterner<S>>();
+
+    auto_set<StateId> initialIds;
+    for (auto const& state : gBuchi.getInitialStates()) {
+      initialIds.emplace(interner->intern(state));
+    }
+
+    auto idTransitions = [gBuchi, interner](StateId id, auto const& visit) {
+      gBuchi.forEachTransition(interner->state(id), [&](A const& label, S const& next) {
+        visit(label, interner->intern(next));
+      });
+    };
+
+    auto idMarks = [gBuchi, interner](StateId id) {
+      return gBuchi.getMarks(interner->state(id));
+    };
+
+    return std::make_pair(MakeGeneralizedBuchi<StateId, A>(initialIds, idTransitions, gBuchi.getNumAcceptanceSets(), idMarks), interner);
+  }
+
+  // Builds the equivalent automaton whose states are the indices of the states of buchi in a dense domain (see dense_set.hh).
+  // Unlike InternStates this needs no table from states to ids, so it takes no memory however many states are explored,
+  // but every reachable state must lie in the domain. Returns the automaton along with the domain, to turn indices back into states.
+  template <typename S, typename A, typename... Fs, typename Domain>
+  auto NumberStates(Buchi<S,A,Fs...> const& buchi, Domain const& domain) {
+    auto states = std::make_shared<Domain const>(domain);
+
+    auto_set<size_t> initialIndices;
+    for (auto const& state : buchi.getInitialStates()) {
+      initialIndices.emplace(states->index(state));
+    }
+
+    auto indexTransitions = [buchi, states](size_t index, auto const& visit) {
+      buchi.forEachTransition(states->value(index), [&](A const& label, S const& next) {
+        visit(label, states->index(next));
+      });
+    };
+
+    auto indexAccepting = [buchi, states](size_t index) {
+      return buchi.accepting(states->value(index));
+    };
+
+    return std::make_pair(MakeBuchi<size_t, A>(initialIndices, indexTransitions, indexAccepting), states);
+  }
+
+  template <typename S, typename A, typename... Fs, typename Domain>
+  auto NumberStates(GeneralizedBuchi<S,A,Fs...> const& gBuchi, Domain const& domain) {
+    auto states = std::make_shared<Domain const>(domain);
+
+    auto_set<size_t> initialIndices;
+    for (auto const& state : gBuchi.getInitialStates()) {
+      initialIndices.emplace(states->index(state));
+    }
+
+    auto indexTransitions = [gBuchi, states](size_t index, auto const& visit) {
+      gBuchi.forEachTransition(states->value(index), [&](A const& label, S const& next) {
+        visit(label, states->index(next));
+      });
+    };
+
+    auto indexMarks = [gBuchi, states](size_t index) {
+      return gBuchi.getMarks(states->value(index));
+    };
+
+    return std::make_pair(MakeGeneralizedBuchi<size_t, A>(initialIndices, indexTransitions, gBuchi.getNumAcceptanceSets(), indexMarks), states);
+  }
+
+  // Turns a sequence of interned ids back into the states they stand for.
+  template <typename S>
+  std::vector<S> MaterializeStates(std::vector<StateId> const& ids, StateInterner<S> const& interner) {
+    std::vector<S> states;
+    states.reserve(ids.size());
+    for (StateId id : ids) {
+      states.emplace_back(interner.state(id));
+    }
+    return states;
+  }
+
+  template <typename S>
+  Lasso<S> MaterializeLasso(Lasso<StateId> const& idLasso, StateInterner<S> const& interner) {
+    return std::make_pair(MaterializeStates(idLasso.first, interner), MaterializeStates(idLasso.second, interner));
+  }
+
+  // Turns a sequence of indices in a dense domain back into the states they stand for.
+  template <typename Domain>
+  auto MaterializeStates(std::vector<size_t> const& indices, Domain const& domain) {
+    std::vector<typename Domain::ValueType> states;
+    states.reserve(indices.size());
+    for (size_t index : indices) {
+      states.emplace_back(domain.value(index));
+    }
+    return states;
+  }
+
+  template <typename Domain>
+  auto MaterializeLasso(Lasso<size_t> const& indexLasso, Domain const& domain) {
+    return std::make_pair(MaterializeStates(indexLasso.first, domain), MaterializeStates(indexLasso.second, domain));
+  }
+}
+
+#endif
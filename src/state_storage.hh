@@ -0,0 +1,262 @@
+#ifndef STATE_STORAGE_HH
+#define STATE_STORAGE_HH
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "auto_set.hh"
+#include "dense_set.hh"
+#include "hash.hh"
+
+namespace mc {
+  // The ways a search can remember the states it has visited.
+  enum class StateStorage {
+    // Every state is stored in full. Nothing is ever missed.
+    Exact,
+    // Holzmann's bitstate hashing: each state sets k bits of a fixed size bit array.
+    // A new state whose bits are all already set is mistaken for a visited one and never explored.
+    Bitstate,
+    // Hash compaction: only a 64 bit fingerprint of each state is stored.
+    // A new state whose fingerprint collides with a visited state's is never explored.
+    HashCompaction
+  };
+
+  inline std::optional<StateStorage> ParseStateStorage(std::string const& name) {
+    if (name == "exact") {
+      return StateStorage::Exact;
+    } else if (name == "bitstate") {
+      return StateStorage::Bitstate;
+    } else if (name == "hashcompact") {
+      return StateStorage::HashCompaction;
+    }
+    return std::nullopt;
+  }
+
+  // Each of the state sets below supports the same operations:
+  //   insert(state) adds the state, returning false if it was (or appears to have been) added before,
+  //   contains(state) checks if the state was (or appears to have been) added,
+  //   size() is the number of states successfully added,
+  //   bytes() estimates the memory used,
+  //   omissionProbability() estimates the probability that at least one state was wrongly reported as already added.
+
+  // Stores every state in full using auto_set.
+  template <typename S>
+  class ExactStateSet {
+  public:
+    explicit ExactStateSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : states(resource) {}
+
+    bool insert(S const& state) {
+      return states.insert(state).second;
+    }
+
+    bool contains(S const& state) const {
+      return states.count(state) == 1;
+    }
+
+    size_t size() const {
+      return states.size();
+    }
+
+    // Counts the state itself plus the node, bucket and hash overhead of the set.
+    // Memory owned by the state (e.g. the contents of a std::vector inside it) is not counted.
+    size_t bytes() const {
+      return states.size() * (sizeof(S) + 4 * sizeof(void*));
+    }
+
+    double omissionProbability() const {
+      return 0;
+    }
+
+  private:
+    pmr::auto_set<S> states;
+  };
+
+  // Stores states that are dense indices below a known bound (e.g. from NumberStates) exactly, with one bit per possible index.
+  template <typename S>
+  class DenseStateSet {
+  public:
+    DenseStateSet(size_t numStates) : states(IntegerDomain<S>(0, static_cast<S>(numStates))) {}
+
+    bool insert(S const& state) {
+      return states.insert(state);
+    }
+
+    bool contains(S const& state) const {
+      return states.contains(state);
+    }
+
+    size_t size() const {
+      return states.size();
+    }
+
+    size_t bytes() const {
+      return states.bytes();
+    }
+
+    double omissionProbability() const {
+      return 0;
+    }
+
+  private:
+    dense_set<S> states;
+  };
+
+  // Holzmann's bitstate hashing. Every state sets numHashes bits of a bit array of fixed size.
+  // The bit positions are derived from a single 64 bit hash by double hashing.
+  template <typename S>
+  class BitstateSet {
+  public:
+    BitstateSet(size_t numBytes, size_t numHashes)
+      : bits(std::max<size_t>(1, numBytes / sizeof(std::uint64_t))),
+        numHashes(std::max<size_t>(1, numHashes)),
+        numStates(0),
+        logNoOmission(0)
+      {}
+
+    bool insert(S const& state) {
+      // The probability that this state is wrongly considered visited is the chance all of its bits are already set.
+      double falsePositive = falsePositiveProbability();
+      bool newBit = false;
+      forEachBit(state, [&](size_t word, std::uint64_t mask) {
+        newBit = newBit || (bits[word] & mask) == 0;
+        bits[word] |= mask;
+      });
+      if (newBit) {
+        ++numStates;
+        logNoOmission += std::log1p(-falsePositive);
+      }
+      return newBit;
+    }
+
+    bool contains(S const& state) const {
+      bool allSet = true;
+      forEachBit(state, [&](size_t word, std::uint64_t mask) {
+        allSet = allSet && (bits[word] & mask) != 0;
+      });
+      return allSet;
+    }
+
+    size_t size() const {
+      return numStates;
+    }
+
+    size_t bytes() const {
+      return bits.size() * sizeof(std::uint64_t);
+    }
+
+    double omissionProbability() const {
+      return -std::expm1(logNoOmission);
+    }
+
+  private:
+    size_t numBits() const {
+      return bits.size() * 64;
+    }
+
+    // The standard estimate (1 - e^(-kn/m))^k of a bloom filter's false positive rate.
+    double falsePositiveProbability() const {
+      double fill = -std::expm1(-static_cast<double>(numHashes) * numStates / numBits());
+      return std::pow(fill, static_cast<double>(numHashes));
+    }
+
+    // Calls f with the index of the word and the mask within that word of each of the numHashes bits of state.
+    template <typename F>
+    void forEachBit(S const& state, F const& f) const {
+      std::uint64_t h1 = MixHash(Hash<S>{}(state));
+      std::uint64_t h2 = MixHash(h1 ^ 0x9e3779b97f4a7c15ULL) | 1;
+      for (size_t i = 0; i < numHashes; ++i) {
+        std::uint64_t bit = (h1 + i * h2) % numBits();
+        f(bit / 64, std::uint64_t(1) << (bit % 64));
+      }
+    }
+
+    std::vector<std::uint64_t> bits;
+    size_t numHashes;
+    size_t numStates;
+    // log of the probability that no insertion so far was a false positive.
+    double logNoOmission;
+  };
+
+  // Hash compaction. Only a 64 bit fingerprint of every state is stored.
+  template <typename S>
+  class HashCompactSet {
+  public:
+    explicit HashCompactSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : fingerprints(resource) {}
+
+    bool insert(S const& state) {
+      return fingerprints.insert(fingerprint(state)).second;
+    }
+
+    bool contains(S const& state) const {
+      return fingerprints.count(fingerprint(state)) == 1;
+    }
+
+    size_t size() const {
+      return fingerprints.size();
+    }
+
+    size_t bytes() const {
+      return fingerprints.size() * (sizeof(std::uint64_t) + 3 * sizeof(void*));
+    }
+
+    // Probability that at least two of the stored states share a fingerprint: 1 - e^(-n(n-1)/2^65).
+    double omissionProbability() const {
+      double n = static_cast<double>(fingerprints.size());
+      return -std::expm1(-n * (n - 1) / std::ldexp(1.0, 65));
+    }
+
+  private:
+    static std::uint64_t fingerprint(S const& state) {
+      return MixHash(Hash<S>{}(state));
+    }
+
+    std::pmr::unordered_set<std::uint64_t> fingerprints;
+  };
+
+  // Selects how a search stores its visited states.
+  struct StateStorageOptions {
+    StateStorage mode = StateStorage::Exact;
+    // Total size in bytes of the bit arrays of bitstate storage.
+    size_t bitstateBytes = size_t(64) << 20;
+    // Number of bits bitstate storage sets per state.
+    size_t numHashes = 3;
+    // If not 0, the states are integers below this bound (e.g. indices from NumberStates)
+    // and exact storage keeps them in bitmaps instead of hash sets.
+    size_t denseStates = 0;
+  };
+
+  namespace _details_ {
+    // Calls f with two empty state sets of the kind chosen in options, e.g. for the two visited sets of the nested DFS.
+    // With bitstate storage the two sets split options.bitstateBytes evenly.
+    // Exact and hash compaction storage allocate from resource.
+    template <typename S, typename F>
+    auto WithStateSets(StateStorageOptions const& options, std::pmr::memory_resource* resource, F const& f) {
+      switch (options.mode) {
+      case StateStorage::Bitstate:
+        return f(BitstateSet<S>(options.bitstateBytes / 2, options.numHashes),
+                 BitstateSet<S>(options.bitstateBytes / 2, options.numHashes));
+
+      case StateStorage::HashCompaction:
+        return f(HashCompactSet<S>(resource), HashCompactSet<S>(resource));
+
+      case StateStorage::Exact:
+      default:
+        if constexpr (std::is_integral_v<S>) {
+          if (options.denseStates != 0) {
+            return f(DenseStateSet<S>(options.denseStates), DenseStateSet<S>(options.denseStates));
+          }
+        }
+        return f(ExactStateSet<S>(resource), ExactStateSet<S>(resource));
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SUCCESSOR_CACHE_HH
+#define SUCCESSOR_CACHE_HH
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include "buchi.hh"
+#include "generalized_buchi.hh"
+#include "hash.hh"
+
+namespace mc {
+  // A bounded cache from states to their transitions that evicts the least recently used state once it is full.
+  // Counts hits and misses so the benefit of caching can be measured. Safe to use from several threads at once.
+  template <typename S, typename TransitionSet>
+  class SuccessorCache {
+  public:
+    SuccessorCache(size_t capacity)
+      : capacity(std::max<size_t>(1, capacity)),
+        numHits(0),
+        numMisses(0)
+      {}
+
+    // Returns the cached transitions of state, or computes them with computeTransitions and caches them.
+    template <typename F>
+    TransitionSet get(S const& state, F const& computeTransitions) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = index.find(state);
+        if (iter != index.end()) {
+          ++numHits;
+          entries.splice(entries.begin(), entries, iter->second);
+          return iter->second->second;
+        }
+        ++numMisses;
+      }
+
+      // Computed without holding the lock, so other threads are not held up by a slow transition function.
+      TransitionSet transitions = computeTransitions(state);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (index.count(state) == 0) {
+        entries.emplace_front(state, transitions);
+        index.emplace(state, entries.begin());
+        if (entries.size() > capacity) {
+          index.erase(entries.back().first);
+          entries.pop_back();
+        }
+      }
+      return transitions;
+    }
+
+    size_t hits() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return numHits;
+    }
+
+    size_t misses() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return numMisses;
+    }
+
+  private:
+    using Entries = std::list<std::pair<S, TransitionSet>>;
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    size_t numHits;
+    size_t numMisses;
+    // Most recently used first.
+    Entries entries;
+    std::unordered_map<S, typename Entries::iterator, Hash<S>> index;
+  };
+
+  // Wraps a Buchi automaton so that the transitions of the capacity most recently expanded states are cached.
+  // Useful when computing transitions is expensive (e.g. in an intersection) and states get expanded repeatedly,
+  // as in the second DFS of the nested DFS. Returns the wrapped automaton along with its cache, for the hit and miss counts.
+  // The wrapped automaton is type erased, which costs little next to looking up the cache.
+  template <typename S, typename A, typename... Fs>
+  auto CacheSuccessors(Buchi<S,A,Fs...> const& buchi, size_t capacity) {
+    using BuchiType = Buchi<S,A>;
+    auto cache = std::make_shared<SuccessorCache<S, typename BuchiType::TransitionSet>>(capacity);
+
+    auto cachedTransitions = [buchi, cache](S const& state) {
+      return cache->get(state, [&buchi](S const& s) { return buchi.getTransitions(s); });
+    };
+    auto accepting = [buchi](S const& state) {
+      return buchi.accepting(state);
+    };
+    return std::make_pair(BuchiType(buchi.getInitialStates(), cachedTransitions, accepting), cache);
+  }
+
+  template <typename S, typename A, typename... Fs>
+  auto CacheSuccessors(GeneralizedBuchi<S,A,Fs...> const& gBuchi, size_t capacity) {
+    using BuchiType = GeneralizedBuchi<S,A>;
+    auto cache = std::make_shared<SuccessorCache<S, typename BuchiType::TransitionSet>>(capacity);
+
+    auto cachedTransitions = [gBuchi, cache](S const& state) {
+      return cache->get(state, [&gBuchi](S const& s) { return gBuchi.getTransitions(s); });
+    };
+    auto marks = [gBuchi](S const& state) {
+      return gBuchi.getMarks(state);
+    };
+    return std::make_pair(BuchiType(gBuchi.getInitialStates(), cachedTransitions, gBuchi.getNumAcceptanceSets(), marks), cache);
+  }
+}
+
+#endif